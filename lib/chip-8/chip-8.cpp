@@ -1,51 +1,53 @@
 #include "chip-8.h"
 
-void Chip8::initialize()
-{
-    printf("Initializing emulator...\n");
-    program_counter = 0x200; // Program counter starts at 0x200
-    opcode_ = 0;             // Reset current opcode
-    index_register = 0;      // Reset index register
-    stack_pointer = 0;       // Reset stack pointer
-    draw_flag = false;
-
-    // Clear display
-    printf("Clearing display...\n");
-    std::memset(&gfx, 0, (SCREEN_WIDTH * SCREEN_HEIGHT) * sizeof(uint8_t));
-
-    // Clear stack
-    printf("Clearing stack...\n");
-    std::memset(&stack, 0, STACK_SIZE * sizeof(uint16_t));
-
-    // Clear registers V0-VF
-    printf("Clearing General Purpose Registers...\n");
-    for (int i = 0; i < GPREG_NUM; i++)
+static constexpr uint8_t chip8_fontset[FONT_SET_SIZE] =
     {
-        std::memset(&gen_purpose_reg_v[i], 0, sizeof(uint8_t));
-    }
-
-    // Clear memory
-    printf("Cleaing memory...\n");
-    std::memset(&memory_, 0, MEM_SIZE * sizeof(u_int8_t));
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+// Power-on machine: zeroed, font set at 0x000, PC at 0x200. Built at compile time so a
+// reset is a plain copy
+static constexpr Chip8State powerOnState()
+{
+    Chip8State state{};
+    for (int i = 0; i < FONT_SET_SIZE; i++)
+        state.memory[i] = chip8_fontset[i];
+    state.program_counter = 0x200; // Program counter starts at 0x200
+    state.rng_state = 1;
+    return state;
+}
 
-    // Load fontset
-    printf("Loading font set...\n");
-    for (int i = 0; i < FONT_SET_SIZE; ++i)
-        memory_[i] = chip8_fontset[i];
+static constexpr Chip8State power_on_state = powerOnState();
 
-    // Reset timers
-    printf("Resetting timers...\n");
-    delay_timer = 0;
-    sound_timer = 0;
+void Chip8::initialize()
+{
+    CHIP8_LOG("Initializing emulator...\n");
+    setState(power_on_state);
+    rng_state = (uint32_t)time(NULL) | 1; // Seed the CXNN generator (xorshift32 must never be 0)
 }
 
 void Chip8::emulateCycle()
 {
-    printf("Fetching and Decoding OPCODE... ");
+    CHIP8_LOG("Fetching and Decoding OPCODE... ");
     // Fetch opcode
-    opcode_ = (memory_[program_counter] << 8) | memory_[program_counter + 1];
+    opcode_ = (memory_[program_counter & 0xFFF] << 8) | memory_[(program_counter + 1) & 0xFFF];
 
-    printf("Fetched opcode: 0x%X\n", opcode_);
+    CHIP8_LOG("Fetched opcode: 0x%X\n", opcode_);
     // printf("program_counter: 0x%X\n", program_counter);
 
     // Decode opcode
@@ -70,13 +72,19 @@ void Chip8::emulateCycle()
             break;
 
         case 0x00EE: // 0x00EE: Returns from subroutine
+            if (stack_pointer == 0 || stack_pointer > STACK_SIZE)
+            {
+                CHIP8_LOG("Stack underflow at 0x%X\n", program_counter);
+                program_counter += 2;
+                break;
+            }
             program_counter = stack[stack_pointer - 1];
             stack_pointer--;
             program_counter += 2;
             break;
 
         default:
-            printf("Unknown opcode [0x0000]: 0x%X\n", opcode_);
+            CHIP8_LOG("Unknown opcode [0x0000]: 0x%X\n", opcode_);
             break;
         }
         break;
@@ -86,6 +94,12 @@ void Chip8::emulateCycle()
         break;
 
     case 0x2000: // 2NNN: Calls subroutine at NNN
+        if (stack_pointer >= STACK_SIZE)
+        {
+            CHIP8_LOG("Stack overflow at 0x%X\n", program_counter);
+            program_counter += 2;
+            break;
+        }
         stack[stack_pointer] = program_counter;
         stack_pointer++;
         program_counter = opcode_ & 0xFFF;
@@ -146,53 +160,52 @@ void Chip8::emulateCycle()
             break;
 
         case 0x0004: // 8XY4: Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not
-            if ((gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] + gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4]) >> 8)
-                gen_purpose_reg_v[16] = 1;
-            else
-                gen_purpose_reg_v[16] = 0;
-            gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] += gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4];
+        {
+            uint16_t sum = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] + gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4];
+            gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] = sum & 0xFF;
+            gen_purpose_reg_v[0xF] = sum >> 8; // VF is written last so that 8FY4 keeps the flag
             program_counter += 2;
-            break;
+        }
+        break;
 
         case 0x0005: // 8XY5: VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not
-            gen_purpose_reg_v[0xF] = 1;
-            for (u_int i = 0; i < sizeof(gen_purpose_reg_v[0]); i++)
-            {
-                if (!(gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8]) && (gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4]))
-                {
-                    gen_purpose_reg_v[0xF] = 0;
-                }
-            }
+        {
+            uint8_t no_borrow = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] >= gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4];
             gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] -= gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4];
+            gen_purpose_reg_v[0xF] = no_borrow;
             program_counter += 2;
-            break;
+        }
+        break;
 
         case 0x0006: // 8XY6: Stores the least significant bit of VX in VF and then shifts VX to the right by 1
-            gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4] = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] & 0x1;
+        {
+            uint8_t lsb = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] & 0x1;
             gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] >>= 1;
+            gen_purpose_reg_v[0xF] = lsb;
             program_counter += 2;
-            break;
+        }
+        break;
 
         case 0x0007: // 8XY7: Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not
-            gen_purpose_reg_v[0xF] = 1;
-            for (u_int i = 0; i < sizeof(gen_purpose_reg_v[0]); i++)
-            {
-                if ((gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8]) && !(gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4]))
-                {
-                    gen_purpose_reg_v[0xF] = 0;
-                }
-            }
+        {
+            uint8_t no_borrow = gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4] >= gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8];
             gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] = gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4] - gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8];
+            gen_purpose_reg_v[0xF] = no_borrow;
             program_counter += 2;
-            break;
+        }
+        break;
 
-        case 0x000E: // 89XYE:  Stores the most significant bit of VX in VF and then shifts VX to the left by 1
-            gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4] = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] & 0x80;
+        case 0x000E: // 8XYE: Stores the most significant bit of VX in VF and then shifts VX to the left by 1
+        {
+            uint8_t msb = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] >> 7;
             gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] <<= 1;
-            break;
+            gen_purpose_reg_v[0xF] = msb;
+            program_counter += 2;
+        }
+        break;
 
         default:
-            printf("Unknown opcode [0x8XY0]: 0x%X\n", opcode_);
+            CHIP8_LOG("Unknown opcode [0x8XY0]: 0x%X\n", opcode_);
             break;
         }
         break;
@@ -215,9 +228,10 @@ void Chip8::emulateCycle()
 
     case 0xC000: // CXNN: Sets VX to the result of a bitwise and operation on a random number (Typically: 0 to 255) and NN
     {
-        srand(time(NULL));
-        uint8_t _rand_ = rand() % 255;
-        gen_purpose_reg_v[(opcode_ & 0xF00) >> 8] = _rand_ & (opcode_ & 0xFF);
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        gen_purpose_reg_v[(opcode_ & 0xF00) >> 8] = (rng_state & 0xFF) & (opcode_ & 0xFF);
         program_counter += 2;
     }
         break;
@@ -226,8 +240,9 @@ void Chip8::emulateCycle()
                  // Each row of 8 pixels is read as bit-coded starting from memory location I; I value does not change after the execution of this instruction.
                  // As described above, VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that does not happen
     {
-        uint8_t x = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8];
-        uint8_t y = gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4];
+        // Sprites wrap around the screen edges
+        uint8_t x = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] % SCREEN_WIDTH;
+        uint8_t y = gen_purpose_reg_v[(opcode_ & 0x00F0) >> 4] % SCREEN_HEIGHT;
         uint8_t height = opcode_ & 0x000F;
         uint8_t pixel;
 
@@ -235,14 +250,16 @@ void Chip8::emulateCycle()
 
         for (int yline = 0; yline < height; yline++)
         {
-            pixel = memory_[index_register + yline];
+            pixel = memory_[(index_register + yline) & 0xFFF];
+            int row = ((y + yline) % SCREEN_HEIGHT) * SCREEN_WIDTH;
             for (int xline = 0; xline < 8; xline++)
             {
                 if ((pixel & (0x80 >> xline)) != 0)
                 {
-                    if (gfx[(x + xline + ((y + yline) * 64))] == 1)
+                    int i = row + (x + xline) % SCREEN_WIDTH;
+                    if (gfx[i] == 1)
                         gen_purpose_reg_v[0xF] = 1;
-                    gfx[x + xline + ((y + yline) * 64)] ^= 1;
+                    gfx[i] ^= 1;
                 }
             }
         }
@@ -255,21 +272,21 @@ void Chip8::emulateCycle()
         switch (opcode_ & 0x00FF)
         {
         case 0x009E: // EX9E: Skips the next instruction if the key stored in VX is pressed (usually the next instruction is a jump to skip a code block)
-            if (key[gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8]] != 0)
+            if (key[gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] & 0xF] != 0)
                 program_counter += 4;
             else
                 program_counter += 2;
             break;
 
         case 0x00A1: // EXA1: Skips the next instruction if the key stored in VX is not pressed (usually the next instruction is a jump to skip a code block)
-            if (key[gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8]] == 0)
+            if (key[gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] & 0xF] == 0)
                 program_counter += 4;
             else
                 program_counter += 2;
             break;
 
         default:
-            printf("Unknown opcode [0xE000]: 0x%X\n", opcode_);
+            CHIP8_LOG("Unknown opcode [0xE000]: 0x%X\n", opcode_);
             break;
         }
         break;
@@ -283,10 +300,16 @@ void Chip8::emulateCycle()
             break;
 
         case 0x000A: // FX0A: A key press is awaited, and then stored in VX (blocking operation, all instruction halted until next key event)
-            char _char_;
-            std::cin >> _char_;
-            gen_purpose_reg_v[(opcode_ & 0xF00) >> 8] = (uint8_t)_char_;
-            program_counter += 2;
+            // PC only advances once a key is down, so the instruction repeats until then
+            for (int i = 0; i < KEY_NUM; i++)
+            {
+                if (key[i] != 0)
+                {
+                    gen_purpose_reg_v[(opcode_ & 0xF00) >> 8] = i;
+                    program_counter += 2;
+                    break;
+                }
+            }
             break;
 
         case 0x0015: // FX15: Sets the delay timer to VX
@@ -305,21 +328,21 @@ void Chip8::emulateCycle()
             break;
 
         case 0x0029: // FX29: Sets I to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font
-            index_register = chip8_fontset[gen_purpose_reg_v[(opcode_ & 0xF00) >> 8]];
+            index_register = (gen_purpose_reg_v[(opcode_ & 0xF00) >> 8] & 0xF) * 5; // Font set is loaded at 0x000, 5 bytes per character
             program_counter += 2;
             break;
 
         case 0x0033: // FX33: Stores the binary-coded decimal representation of VX, with the hundreds digit in memory at location in I, the tens digit at location I+1, and the ones digit at location I+2
-            memory_[index_register] = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] / 100;
-            memory_[index_register + 1] = (gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] / 10) % 10;
-            memory_[index_register + 2] = (gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] % 100) % 10;
+            memory_[index_register & 0xFFF] = gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] / 100;
+            memory_[(index_register + 1) & 0xFFF] = (gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] / 10) % 10;
+            memory_[(index_register + 2) & 0xFFF] = (gen_purpose_reg_v[(opcode_ & 0x0F00) >> 8] % 100) % 10;
             program_counter += 2;
             break;
 
         case 0x0055: // FX55: Stores from V0 to VX (including VX) in memory, starting at address I. The offset from I is increased by 1 for each value written, but I itself is left unmodified
             for (int i = 0; i <= ((opcode_ & 0xF00) >> 8); i++)
             {
-                memory_[index_register + i] = gen_purpose_reg_v[i];
+                memory_[(index_register + i) & 0xFFF] = gen_purpose_reg_v[i];
             }
             program_counter += 2;
             break;
@@ -327,19 +350,19 @@ void Chip8::emulateCycle()
         case 0x0065: // FX65: Fills from V0 to VX (including VX) with values from memory, starting at address I. The offset from I is increased by 1 for each value read, but I itself is left unmodified
             for (int i = 0; i <= ((opcode_ & 0xF00) >> 8); i++)
             {
-                gen_purpose_reg_v[i] = memory_[index_register + i];
+                gen_purpose_reg_v[i] = memory_[(index_register + i) & 0xFFF];
             }
             program_counter += 2;
             break;
 
         default:
-            printf("Unknown opcode [0xFX00]: 0x%X\n", opcode_);
+            CHIP8_LOG("Unknown opcode [0xFX00]: 0x%X\n", opcode_);
             break;
         }
         break;
 
     default:
-        printf("Unknown opcode: 0x%X\n", opcode_);
+        CHIP8_LOG("Unknown opcode: 0x%X\n", opcode_);
         break;
     }
 
@@ -350,182 +373,137 @@ void Chip8::emulateCycle()
     if (sound_timer > 0)
     {
         if (sound_timer == 1)
-            printf("BEEP!\n");
+            CHIP8_LOG("BEEP!\n");
         --sound_timer;
     }
 }
 
+uint16_t Chip8::nextOpcode() const
+{
+    return (memory_[program_counter & 0xFFF] << 8) | memory_[(program_counter + 1) & 0xFFF];
+}
+
 void Chip8::loadGame(char *game_name)
 {
-    // Use fopen (in binary mode) and start filling the memory at location: 0x200 == 512
-    printf("Loading game into memory...\n");
-    FILE *fp = std::fopen(game_name, "r+b");
+    // Use fopen (in binary mode) and read the whole ROM straight into memory at location: 0x200 == 512
+    CHIP8_LOG("Loading game into memory...\n");
+    FILE *fp = std::fopen(game_name, "rb");
     if (!fp)
     {
         std::perror("File opening failed");
+        return;
     }
-    int c;
-    int i{0};
-    while ((c = std::fgetc(fp)) != EOF) // standard C I/O file reading loop
-    {
-        memory_[i + 512] = (uint8_t)c;
-        i++;
-    }
+    size_t size = std::fread(&memory_[0x200], 1, MEM_SIZE - 0x200, fp);
+    if (std::fgetc(fp) != EOF)
+        CHIP8_LOG("ROM truncated to %zu bytes\n", size);
     fclose(fp);
-    printf("Game Loaded!\n");
+    CHIP8_LOG("Game Loaded! (%zu bytes)\n", size);
 }
 
-void Chip8::setKeyDown(int key_down)
+void Chip8::getState(Chip8State &state) const
+{
+    std::memcpy(state.memory, memory_, sizeof(memory_));
+    std::memcpy(state.gfx, gfx, sizeof(gfx));
+    std::memcpy(state.stack, stack, sizeof(stack));
+    state.opcode = opcode_;
+    state.index_register = index_register;
+    state.program_counter = program_counter;
+    state.stack_pointer = stack_pointer;
+    state.rng_state = rng_state;
+    std::memcpy(state.gen_purpose_reg_v, gen_purpose_reg_v, sizeof(gen_purpose_reg_v));
+    std::memcpy(state.key, key, sizeof(key));
+    state.delay_timer = delay_timer;
+    state.sound_timer = sound_timer;
+    state.draw_flag = draw_flag;
+    state.reserved = 0;
+}
+
+void Chip8::setState(const Chip8State &state)
 {
-    printf("Fetching pressed key...\n");
+    std::memcpy(memory_, state.memory, sizeof(memory_));
+    std::memcpy(gfx, state.gfx, sizeof(gfx));
+    std::memcpy(stack, state.stack, sizeof(stack));
+    opcode_ = state.opcode;
+    index_register = state.index_register;
+    program_counter = state.program_counter;
+    stack_pointer = state.stack_pointer;
+    rng_state = state.rng_state;
+    std::memcpy(gen_purpose_reg_v, state.gen_purpose_reg_v, sizeof(gen_purpose_reg_v));
+    std::memcpy(key, state.key, sizeof(key));
+    delay_timer = state.delay_timer;
+    sound_timer = state.sound_timer;
+    draw_flag = state.draw_flag != 0;
+}
 
-    switch (key_down)
+int Chip8::keyIndex(int sdl_key)
+{
+    switch (sdl_key)
     {
     case SDLK_1: // 1
-        key[0] = 1;
-        break;
-
+        return 0;
     case SDLK_2: // 2
-        key[1] = 1;
-        break;
-
+        return 1;
     case SDLK_3: // 3
-        key[2] = 1;
-        break;
-
+        return 2;
     case SDLK_4: // 4
-        key[3] = 1;
-        break;
-
+        return 3;
     case SDLK_q: // q
-        key[4] = 1;
-        break;
-
+        return 4;
     case SDLK_w: // w
-        key[5] = 1;
-        break;
-
+        return 5;
     case SDLK_e: // e
-        key[6] = 1;
-        break;
-
+        return 6;
     case SDLK_r: // r
-        key[7] = 1;
-        break;
-
+        return 7;
     case SDLK_a: // a
-        key[8] = 1;
-        break;
-
+        return 8;
     case SDLK_s: // s
-        key[9] = 1;
-        break;
-
+        return 9;
     case SDLK_d: // d
-        key[10] = 1;
-        break;
-
+        return 10;
     case SDLK_f: // f
-        key[11] = 1;
-        break;
-
+        return 11;
     case SDLK_z: // z
-        key[12] = 1;
-        break;
-
+        return 12;
     case SDLK_x: // x
-        key[13] = 1;
-        break;
-
+        return 13;
     case SDLK_c: // c
-        key[14] = 1;
-        break;
-
+        return 14;
     case SDLK_v: // v
-        key[15] = 1;
-        break;
-
+        return 15;
     default:
-        printf("Unknown key: %d\n", key_down);
-        break;
+        return -1;
     }
 }
 
-void Chip8::setKeyUp(int key_up)
+void Chip8::setKeyDown(int key_down)
 {
-    printf("Fetching released key...\n");
-
-    switch (key_up)
-    {
-    case SDLK_1: // 1
-        key[0] = 0;
-        break;
+    CHIP8_LOG("Fetching pressed key...\n");
 
-    case SDLK_2: // 2
-        key[1] = 0;
-        break;
-
-    case SDLK_3: // 3
-        key[2] = 0;
-        break;
-
-    case SDLK_4: // 4
-        key[3] = 0;
-        break;
-
-    case SDLK_q: // q
-        key[4] = 0;
-        break;
-
-    case SDLK_w: // w
-        key[5] = 0;
-        break;
-
-    case SDLK_e: // e
-        key[6] = 0;
-        break;
-
-    case SDLK_r: // r
-        key[7] = 0;
-        break;
-
-    case SDLK_a: // a
-        key[8] = 0;
-        break;
-
-    case SDLK_s: // s
-        key[9] = 0;
-        break;
-
-    case SDLK_d: // d
-        key[10] = 0;
-        break;
-
-    case SDLK_f: // f
-        key[11] = 0;
-        break;
-
-    case SDLK_z: // z
-        key[12] = 0;
-        break;
-
-    case SDLK_x: // x
-        key[13] = 0;
-        break;
+    int i = keyIndex(key_down);
+    if (i < 0)
+        CHIP8_LOG("Unknown key: %d\n", key_down);
+    else
+        key[i] = 1;
+}
 
-    case SDLK_c: // c
-        key[14] = 0;
-        break;
+void Chip8::setKeyUp(int key_up)
+{
+    CHIP8_LOG("Fetching released key...\n");
 
-    case SDLK_v: // v
-        key[15] = 0;
-        break;
+    int i = keyIndex(key_up);
+    if (i < 0)
+        CHIP8_LOG("Unknown key: %d\n", key_up);
+    else
+        key[i] = 0;
+}
 
-    default:
-        printf("Unknown key: %d\n", key_up);
-        break;
-    }
+void Chip8::setKeys(uint16_t key_mask)
+{
+    for (int i = 0; i < KEY_NUM; i++)
+        key[i] = (key_mask >> i) & 1;
 }
+
 /*
 OPCODES
 
@@ -9,6 +9,13 @@
 #define SCREEN_HEIGHT 32
 #define SCREEN_WIDTH 64
 
+// Build with -DCHIP8_QUIET to drop the per-cycle trace output (fuzzer, headless tools)
+#ifdef CHIP8_QUIET
+#define CHIP8_LOG(...) (0 ? (void)printf(__VA_ARGS__) : (void)0) // Arguments still count as used
+#else
+#define CHIP8_LOG(...) printf(__VA_ARGS__)
+#endif
+
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -17,6 +24,28 @@
 #include <iostream>
 #include <SDL2/SDL.h>
 
+// Complete machine state in a fixed layout (no pointers, explicit padding) so it can be
+// copied, compared and stored as a flat blob
+struct Chip8State
+{
+    uint8_t memory[MEM_SIZE];
+    uint8_t gfx[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint16_t stack[STACK_SIZE];
+    uint16_t opcode;
+    uint16_t index_register;
+    uint16_t program_counter;
+    uint16_t stack_pointer;
+    uint32_t rng_state; // xorshift32 state used by CXNN, never 0
+    uint8_t gen_purpose_reg_v[GPREG_NUM];
+    uint8_t key[KEY_NUM];
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t draw_flag;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(Chip8State) == 6224, "Chip8State layout changed");
+
 class Chip8
 {
     uint16_t opcode_;
@@ -39,6 +68,8 @@ class Chip8
     uint16_t stack[STACK_SIZE];
     uint16_t stack_pointer;
 
+    uint32_t rng_state; // CXNN random generator (xorshift32)
+
     uint8_t key[KEY_NUM]; // HEX based keypad (0x0-0xF)
                           //
                           // Keypad                   Keyboard
@@ -52,34 +83,19 @@ class Chip8
                           // |A|0|B|F|                |Z|X|C|V|
                           // +-+-+-+-+                +-+-+-+-+
 
-    uint8_t chip8_fontset[FONT_SET_SIZE] =
-        {
-            0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-            0x20, 0x60, 0x20, 0x20, 0x70, // 1
-            0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-            0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-            0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-            0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-            0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-            0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-            0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-            0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-            0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-            0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-            0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-            0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-            0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-            0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    };
-
 public:
     bool draw_flag;
     uint8_t gfx[SCREEN_WIDTH * SCREEN_HEIGHT]; // 64 x 32 = 2048 pixels screen
     void initialize();
     void emulateCycle();
+    uint16_t nextOpcode() const; // Opcode the next emulateCycle() will execute
     void loadGame(char *game_name);
     void setKeyDown(int key_down);
     void setKeyUp(int key_up);
+    void setKeys(uint16_t key_mask); // Bit i set = key i held
+    static int keyIndex(int sdl_key); // Keypad index for a keyboard key, -1 if unmapped
+    void getState(Chip8State &state) const;
+    void setState(const Chip8State &state);
 };
 
 #endif /* CHIP_8_H */
\ No newline at end of file
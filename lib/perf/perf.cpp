@@ -0,0 +1,201 @@
+#include "perf.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *event_names[PERF_EVENT_NUM] = {"cycles", "instructions", "branch_misses", "l1d_misses"};
+
+static int openEvent(PerfEvent event, int group_fd)
+{
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = group_fd < 0; // Leader starts disabled, members follow it
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event)
+    {
+    case PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:
+        return -1;
+    }
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+    {
+        fd_[i] = -1;
+        slot_[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+bool PerfCounters::open()
+{
+    close();
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+    {
+        int fd = openEvent((PerfEvent)i, leader_);
+        if (fd < 0)
+        {
+            if (!error_.empty())
+                error_ += ", ";
+            error_ += std::string(event_names[i]) + ": " + std::strerror(errno);
+            continue;
+        }
+        fd_[i] = fd;
+        slot_[i] = opened_++;
+        if (leader_ < 0)
+            leader_ = fd;
+    }
+
+    if (leader_ < 0)
+        return false;
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::close()
+{
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+    {
+        if (fd_[i] >= 0)
+            ::close(fd_[i]);
+        fd_[i] = -1;
+        slot_[i] = -1;
+    }
+    leader_ = -1;
+    opened_ = 0;
+    error_.clear();
+}
+
+bool PerfCounters::available(PerfEvent event) const
+{
+    return slot_[event] >= 0;
+}
+
+const std::string &PerfCounters::error() const
+{
+    return error_;
+}
+
+void PerfCounters::read(PerfSample &sample) const
+{
+    std::memset(&sample, 0, sizeof(sample));
+    if (leader_ < 0)
+        return;
+
+    // Group read layout: nr, time_enabled, time_running, then one value per event in the
+    // order they were opened
+    uint64_t buffer[3 + PERF_EVENT_NUM];
+    if (::read(leader_, buffer, sizeof(buffer)) < (ssize_t)(3 * sizeof(uint64_t)))
+        return;
+    sample.time_enabled = buffer[1];
+    sample.time_running = buffer[2];
+    double scale = buffer[2] ? (double)buffer[1] / buffer[2] : 0;
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+        if (slot_[i] >= 0 && (uint64_t)slot_[i] < buffer[0])
+            sample.value[i] = buffer[2] == buffer[1] ? buffer[3 + slot_[i]] : (uint64_t)(buffer[3 + slot_[i]] * scale);
+}
+
+PerfSection::PerfSection(const char *name) : name_(name)
+{
+    reset();
+}
+
+void PerfSection::begin(const PerfCounters &counters)
+{
+    start_time_ = std::chrono::steady_clock::now();
+    counters.read(start_);
+}
+
+void PerfSection::end(const PerfCounters &counters, uint64_t guest_instructions)
+{
+    PerfSample now;
+    counters.read(now);
+    seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+        total_.value[i] += now.value[i] - start_.value[i];
+    total_.time_enabled += now.time_enabled - start_.time_enabled;
+    total_.time_running += now.time_running - start_.time_running;
+    guest_instructions_ += guest_instructions;
+    entries_++;
+}
+
+void PerfSection::reset()
+{
+    std::memset(&start_, 0, sizeof(start_));
+    std::memset(&total_, 0, sizeof(total_));
+    seconds_ = 0;
+    guest_instructions_ = 0;
+    entries_ = 0;
+}
+
+void PerfSection::subtract(const PerfSection &inner)
+{
+    for (int i = 0; i < PERF_EVENT_NUM; i++)
+        total_.value[i] -= std::min(total_.value[i], inner.total_.value[i]);
+    total_.time_enabled -= std::min(total_.time_enabled, inner.total_.time_enabled);
+    total_.time_running -= std::min(total_.time_running, inner.total_.time_running);
+    seconds_ -= std::min(seconds_, inner.seconds_);
+    guest_instructions_ -= std::min(guest_instructions_, inner.guest_instructions_);
+}
+
+/*
+    Adds <section>_<metric> fields. Rates are per guest instruction when the section ran
+    guest code, per pass otherwise (render); counters that are not available, or that the
+    group never got onto the PMU for during the section, come out null. counter_coverage is
+    the share of the section the counters actually ran for, below 1 the counts are scaled
+*/
+void PerfSection::report(Stats &stats, const PerfCounters &counters) const
+{
+    std::string prefix = std::string(name_) + "_";
+    double per = guest_instructions_ ? (double)guest_instructions_ : (double)entries_;
+    const char *unit = guest_instructions_ ? "_per_guest_instruction" : "_per_pass";
+    bool counted = total_.time_running > 0;
+    auto counter = [&](PerfEvent event) {
+        return counters.available(event) && counted ? (double)total_.value[event] : NAN;
+    };
+
+    stats.add((prefix + "passes").c_str(), entries_);
+    stats.add((prefix + "guest_instructions").c_str(), guest_instructions_);
+    stats.add((prefix + "seconds").c_str(), seconds_);
+    stats.add((prefix + "counter_coverage").c_str(), counted ? (double)total_.time_running / total_.time_enabled : NAN);
+    stats.add((prefix + "cycles").c_str(), counter(PERF_CYCLES));
+    stats.add((prefix + "instructions").c_str(), counter(PERF_INSTRUCTIONS));
+    stats.add((prefix + "ipc").c_str(), counter(PERF_INSTRUCTIONS) / counter(PERF_CYCLES));
+    stats.add((prefix + "host_instructions" + unit).c_str(), counter(PERF_INSTRUCTIONS) / per);
+    stats.add((prefix + "branch_misses" + unit).c_str(), counter(PERF_BRANCH_MISSES) / per);
+    stats.add((prefix + "l1d_misses" + unit).c_str(), counter(PERF_L1D_MISSES) / per);
+}
@@ -0,0 +1,71 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "stats.h"
+
+enum PerfEvent
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_EVENT_NUM
+};
+
+struct PerfSample
+{
+    uint64_t value[PERF_EVENT_NUM]; // Scaled up to time_enabled when the group was multiplexed
+    uint64_t time_enabled;          // ns the group was enabled
+    uint64_t time_running;          // ns the group was actually on the PMU
+};
+
+/*
+    Hardware counters for the calling thread (user space only) through perf_event_open,
+    opened as one group so a single read() returns all of them. Counters the kernel or
+    CPU refuse (containers, VMs, perf_event_paranoid) are left out and reported as null;
+    if none open, every read returns zeros and the caller still gets wall-clock numbers.
+    When the kernel multiplexes the PMU between more events than it has counters, the
+    group only counts part of the time; reads scale the counts by enabled / running time.
+*/
+class PerfCounters
+{
+    int leader_ = -1;
+    int fd_[PERF_EVENT_NUM];
+    int slot_[PERF_EVENT_NUM]; // Position of each event in the group read, -1 if missing
+    int opened_ = 0;
+    std::string error_;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    bool open(); // False if no counter is available
+    void close();
+    bool available(PerfEvent event) const;
+    const std::string &error() const;
+    void read(PerfSample &sample) const;
+};
+
+// Counter deltas accumulated over every pass through one instrumented section
+class PerfSection
+{
+    const char *name_;
+    PerfSample start_;
+    PerfSample total_;
+    std::chrono::steady_clock::time_point start_time_;
+    double seconds_ = 0;
+    uint64_t guest_instructions_ = 0;
+    uint64_t entries_ = 0;
+
+public:
+    explicit PerfSection(const char *name);
+    void begin(const PerfCounters &counters);
+    void end(const PerfCounters &counters, uint64_t guest_instructions);
+    void reset();
+    void subtract(const PerfSection &inner); // Removes a section that ran nested inside this one
+    void report(Stats &stats, const PerfCounters &counters) const;
+};
+
+#endif /* PERF_H */
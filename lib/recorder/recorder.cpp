@@ -0,0 +1,356 @@
+#include "recorder.h"
+
+// Byte i holds column i % 64 of the band of 8 rows starting at row (i / 64) * 8, top row in
+// bit 0. Sprites are 8 pixels wide, so a moving sprite or paddle touches fewer bytes in
+// columns than in rows
+void packFrame(const uint8_t *gfx, uint8_t *packed)
+{
+    for (int i = 0; i < PACKED_FRAME_SIZE; i++)
+    {
+        const uint8_t *column = &gfx[(i / SCREEN_WIDTH) * 8 * SCREEN_WIDTH + i % SCREEN_WIDTH];
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++)
+            byte |= (column[b * SCREEN_WIDTH] & 1) << b;
+        packed[i] = byte;
+    }
+}
+
+void unpackFrame(const uint8_t *packed, uint8_t *gfx)
+{
+    for (int i = 0; i < PACKED_FRAME_SIZE; i++)
+    {
+        uint8_t *column = &gfx[(i / SCREEN_WIDTH) * 8 * SCREEN_WIDTH + i % SCREEN_WIDTH];
+        for (int b = 0; b < 8; b++)
+            column[b * SCREEN_WIDTH] = (packed[i] >> b) & 1;
+    }
+}
+
+void putVarint(std::vector<uint8_t> &out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+bool getVarint(const uint8_t *data, size_t size, size_t &pos, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < size; shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Literal runs absorb single zero bytes, a zero run only starts at two or more zeros.
+// Trailing zeros are left out, the decoder fills them in
+void encodeRle(const uint8_t *bytes, size_t size, std::vector<uint8_t> &out)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t zeros = 0;
+        while (i + zeros < size && bytes[i + zeros] == 0)
+            zeros++;
+        i += zeros;
+        if (i == size)
+            break;
+
+        size_t literal_end = i;
+        while (literal_end < size && !(bytes[literal_end] == 0 && (literal_end + 1 == size || bytes[literal_end + 1] == 0)))
+            literal_end++;
+
+        putVarint(out, zeros);
+        putVarint(out, literal_end - i);
+        out.insert(out.end(), bytes + i, bytes + literal_end);
+        i = literal_end;
+    }
+}
+
+bool decodeRle(const uint8_t *in, size_t in_size, uint8_t *bytes, size_t size)
+{
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < size && pos < in_size)
+    {
+        uint32_t zeros, literals;
+        if (!getVarint(in, in_size, pos, zeros) || !getVarint(in, in_size, pos, literals))
+            return false;
+        if (zeros > size - i || literals > size - i - zeros || literals > in_size - pos)
+            return false;
+        std::memset(bytes + i, 0, zeros);
+        i += zeros;
+        std::memcpy(bytes + i, in + pos, literals);
+        i += literals;
+        pos += literals;
+    }
+    std::memset(bytes + i, 0, size - i);
+    return pos == in_size;
+}
+
+Recorder::~Recorder()
+{
+    close();
+}
+
+bool Recorder::open(const char *path)
+{
+    printf("Recording to %s...\n", path);
+    fp_ = std::fopen(path, "wb");
+    if (!fp_)
+    {
+        std::perror("Recording file opening failed");
+        return false;
+    }
+
+    offset_ = 0;
+    const uint8_t header[] = {'C', '8', 'R', 'V', RECORDING_VERSION, SCREEN_WIDTH, SCREEN_HEIGHT};
+    writeBytes(header, sizeof(header));
+
+    head_ = 0;
+    tail_ = 0;
+    stop_ = false;
+    dropped_ = 0;
+    frames_ = 0;
+    index_.clear();
+    start_ = std::chrono::steady_clock::now();
+    writer_ = std::thread(&Recorder::writerLoop, this);
+    return true;
+}
+
+void Recorder::capture(const uint8_t *gfx)
+{
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= RECORDER_QUEUE_SIZE)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot &slot = ring_[head % RECORDER_QUEUE_SIZE];
+    slot.ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+    packFrame(gfx, slot.packed);
+    head_.store(head + 1, std::memory_order_release);
+}
+
+void Recorder::writerLoop()
+{
+    for (;;)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+        {
+            if (stop_.load(std::memory_order_acquire) && tail == head_.load(std::memory_order_acquire))
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        writeFrame(ring_[tail % RECORDER_QUEUE_SIZE]);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+}
+
+void Recorder::writeFrame(const Slot &slot)
+{
+    if (frames_ > 0 && std::memcmp(slot.packed, previous_, PACKED_FRAME_SIZE) == 0)
+        return;
+
+    bool keyframe = frames_ % RECORDER_KEYFRAME_INTERVAL == 0;
+    std::vector<uint8_t> payload;
+    if (keyframe)
+    {
+        encodeRle(slot.packed, PACKED_FRAME_SIZE, payload);
+        index_.push_back({frames_, offset_, slot.ms});
+    }
+    else
+    {
+        uint8_t delta[PACKED_FRAME_SIZE];
+        for (int i = 0; i < PACKED_FRAME_SIZE; i++)
+            delta[i] = slot.packed[i] ^ previous_[i];
+        encodeRle(delta, PACKED_FRAME_SIZE, payload);
+    }
+
+    std::vector<uint8_t> record;
+    putVarint(record, ((keyframe ? slot.ms : slot.ms - previous_ms_) << 1) | keyframe);
+    putVarint(record, payload.size());
+    record.insert(record.end(), payload.begin(), payload.end());
+    writeBytes(record.data(), record.size());
+
+    std::memcpy(previous_, slot.packed, PACKED_FRAME_SIZE);
+    previous_ms_ = slot.ms;
+    frames_++;
+}
+
+void Recorder::writeBytes(const uint8_t *bytes, size_t size)
+{
+    std::fwrite(bytes, 1, size, fp_);
+    offset_ += size;
+}
+
+void Recorder::close()
+{
+    if (!fp_)
+        return;
+    stop_ = true;
+    writer_.join();
+
+    std::vector<uint8_t> index;
+    uint32_t index_offset = offset_;
+    index.push_back('I');
+    putVarint(index, index_.size());
+    for (const RecordingIndexEntry &entry : index_)
+    {
+        putVarint(index, entry.frame);
+        putVarint(index, entry.offset);
+        putVarint(index, entry.ms);
+    }
+    for (int i = 0; i < 4; i++)
+        index.push_back((index_offset >> (8 * i)) & 0xFF);
+    index.insert(index.end(), RECORDING_INDEX_MAGIC, RECORDING_INDEX_MAGIC + 4);
+    writeBytes(index.data(), index.size());
+
+    fclose(fp_);
+    fp_ = nullptr;
+    printf("Recording closed: %u frames, %u bytes, %llu dropped\n", frames_, offset_, (unsigned long long)dropped_.load());
+}
+
+uint64_t Recorder::dropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+uint32_t Recorder::frames() const
+{
+    return frames_;
+}
+
+uint32_t Recorder::bytes() const
+{
+    return offset_;
+}
+
+bool Playback::open(const char *path)
+{
+    FILE *fp = std::fopen(path, "rb");
+    if (!fp)
+    {
+        std::perror("Recording file opening failed");
+        return false;
+    }
+    data_.clear();
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        data_.insert(data_.end(), buffer, buffer + count);
+    fclose(fp);
+
+    if (data_.size() < 7 || std::memcmp(data_.data(), RECORDING_MAGIC, 4) != 0 || data_[4] != RECORDING_VERSION || data_[5] != SCREEN_WIDTH || data_[6] != SCREEN_HEIGHT)
+    {
+        printf("Not a version %d recording: %s\n", RECORDING_VERSION, path);
+        return false;
+    }
+
+    // A recording cut short (crash) has no index; it still plays sequentially
+    end_ = data_.size();
+    index_.clear();
+    size_t size = data_.size();
+    if (size >= 15 && std::memcmp(&data_[size - 4], RECORDING_INDEX_MAGIC, 4) == 0)
+    {
+        uint32_t index_offset = data_[size - 8] | (data_[size - 7] << 8) | (data_[size - 6] << 16) | ((uint32_t)data_[size - 5] << 24);
+        size_t pos = index_offset;
+        uint32_t entries;
+        if (index_offset >= 7 && index_offset < size - 8 && data_[pos++] == 'I' && getVarint(data_.data(), size - 8, pos, entries))
+        {
+            end_ = index_offset;
+            for (uint32_t i = 0; i < entries; i++)
+            {
+                RecordingIndexEntry entry;
+                if (!getVarint(data_.data(), size - 8, pos, entry.frame) || !getVarint(data_.data(), size - 8, pos, entry.offset) || !getVarint(data_.data(), size - 8, pos, entry.ms))
+                    break;
+                index_.push_back(entry);
+            }
+        }
+    }
+
+    pos_ = 7;
+    ms_ = 0;
+    frame_ = 0;
+    std::memset(packed_, 0, sizeof(packed_));
+    return true;
+}
+
+bool Playback::next(uint8_t *gfx, uint32_t &ms)
+{
+    uint32_t time, size;
+    if (pos_ >= end_)
+        return false;
+    if (!getVarint(data_.data(), end_, pos_, time) || !getVarint(data_.data(), end_, pos_, size) || size > end_ - pos_)
+    {
+        pos_ = end_;
+        return false;
+    }
+
+    uint8_t payload[PACKED_FRAME_SIZE];
+    if (!decodeRle(&data_[pos_], size, payload, PACKED_FRAME_SIZE))
+    {
+        pos_ = end_;
+        return false;
+    }
+    pos_ += size;
+
+    bool keyframe = time & 1;
+    time >>= 1;
+    if (keyframe)
+    {
+        std::memcpy(packed_, payload, PACKED_FRAME_SIZE);
+        ms_ = time;
+    }
+    else
+    {
+        for (int i = 0; i < PACKED_FRAME_SIZE; i++)
+            packed_[i] ^= payload[i];
+        ms_ += time;
+    }
+    frame_++;
+
+    unpackFrame(packed_, gfx);
+    ms = ms_;
+    return true;
+}
+
+bool Playback::seek(uint32_t ms)
+{
+    const RecordingIndexEntry *best = nullptr;
+    for (const RecordingIndexEntry &entry : index_)
+        if (entry.ms <= ms && entry.offset >= 7 && entry.offset < end_)
+            best = &entry;
+
+    if (!best)
+    {
+        pos_ = 7;
+        ms_ = 0;
+        frame_ = 0;
+        std::memset(packed_, 0, sizeof(packed_));
+        return false;
+    }
+    pos_ = best->offset;
+    ms_ = best->ms;
+    frame_ = best->frame;
+    return true;
+}
+
+uint32_t Playback::frame() const
+{
+    return frame_;
+}
+
+const std::vector<RecordingIndexEntry> &Playback::index() const
+{
+    return index_;
+}
@@ -0,0 +1,109 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#define RECORDING_MAGIC "C8RV"
+#define RECORDING_INDEX_MAGIC "C8RI"
+#define RECORDING_VERSION 1
+#define RECORDER_QUEUE_SIZE 256          // Frames in flight between the emulator and the writer
+#define RECORDER_KEYFRAME_INTERVAL 600   // Frames between keyframes
+#define PACKED_FRAME_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT / 8)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip-8.h"
+
+/*
+    *** Recording file layout ***
+    Header: "C8RV", version, width, height (1 byte each)
+    Frames: time << 1 | keyframe (varint), payload size (varint), payload
+            time is ms since the start for a keyframe and ms since the previous frame for a delta
+            payload is the RLE of the 1 bit per pixel frame (keyframe) or of its XOR with the
+            previous frame (delta); RLE = repeated (zero run varint, literal count varint,
+            literals), bytes past the end of the payload are zero
+    Index:  'I', count (varint), then per keyframe: frame number, file offset, time (varints)
+    Footer: index offset (4 bytes, little endian), "C8RI"
+
+    Frames identical to the previous one are not stored.
+*/
+
+struct RecordingIndexEntry
+{
+    uint32_t frame;
+    uint32_t offset;
+    uint32_t ms;
+};
+
+// Captures frames on the emulation thread and writes them from a background thread. The
+// hand-off is a single producer, single consumer ring: capture() never waits, and if the
+// writer falls behind by a whole ring the frame is dropped and counted instead
+class Recorder
+{
+    struct Slot
+    {
+        uint32_t ms;
+        uint8_t packed[PACKED_FRAME_SIZE];
+    };
+
+    Slot ring_[RECORDER_QUEUE_SIZE];
+    std::atomic<uint32_t> head_{0}; // Next slot to fill (emulation thread)
+    std::atomic<uint32_t> tail_{0}; // Next slot to write (writer thread)
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> dropped_{0};
+
+    FILE *fp_ = nullptr;
+    std::thread writer_;
+    std::chrono::steady_clock::time_point start_;
+
+    // Writer thread state
+    uint8_t previous_[PACKED_FRAME_SIZE];
+    uint32_t previous_ms_ = 0;
+    uint32_t frames_ = 0;
+    uint32_t offset_ = 0;
+    std::vector<RecordingIndexEntry> index_;
+
+    void writerLoop();
+    void writeFrame(const Slot &slot);
+    void writeBytes(const uint8_t *bytes, size_t size);
+
+public:
+    ~Recorder();
+    bool open(const char *path);
+    void capture(const uint8_t *gfx); // Emulation thread
+    void close();                     // Drains the ring and writes the index
+    uint64_t dropped() const;
+    uint32_t frames() const;          // Valid after close()
+    uint32_t bytes() const;           // Valid after close()
+};
+
+// Decodes a recording held in memory, sequentially or from the nearest keyframe
+class Playback
+{
+    std::vector<uint8_t> data_;
+    std::vector<RecordingIndexEntry> index_;
+    size_t pos_ = 0;
+    size_t end_ = 0; // Start of the index
+    uint8_t packed_[PACKED_FRAME_SIZE];
+    uint32_t ms_ = 0;
+    uint32_t frame_ = 0;
+
+public:
+    bool open(const char *path);
+    bool next(uint8_t *gfx, uint32_t &ms); // Unpacked frame (one byte per pixel) and its time
+    bool seek(uint32_t ms);                // Next frame returned is the last keyframe at or before ms
+    uint32_t frame() const;                // Number of the frame next() returns
+    const std::vector<RecordingIndexEntry> &index() const;
+};
+
+// Shared by both sides
+void packFrame(const uint8_t *gfx, uint8_t *packed);
+void unpackFrame(const uint8_t *packed, uint8_t *gfx);
+void encodeRle(const uint8_t *bytes, size_t size, std::vector<uint8_t> &out);
+bool decodeRle(const uint8_t *in, size_t in_size, uint8_t *bytes, size_t size);
+void putVarint(std::vector<uint8_t> &out, uint32_t value);
+bool getVarint(const uint8_t *data, size_t size, size_t &pos, uint32_t &value);
+
+#endif /* RECORDER_H */
@@ -0,0 +1,180 @@
+#include "grid-screen.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define TILE_WIDTH (SCREEN_WIDTH + GRID_TILE_GAP)
+#define TILE_HEIGHT (SCREEN_HEIGHT + GRID_TILE_GAP)
+#define PIXEL_ON 0xFFFFFFFF
+#define PIXEL_OFF 0xFF000000
+#define PIXEL_GAP 0xFF303030
+
+void GridInstance::step()
+{
+    chip8.setKeys(key_mask_.load(std::memory_order_relaxed));
+    chip8.emulateCycle();
+
+    if (chip8.draw_flag)
+    {
+        frame_pending_ = true;
+        chip8.draw_flag = false;
+    }
+
+    // Never wait for the viewer: if it is copying the frame right now, publish next cycle
+    if (frame_pending_ && frame_mutex_.try_lock())
+    {
+        std::memcpy(frame_, chip8.gfx, sizeof(frame_));
+        frame_mutex_.unlock();
+        frame_count_.fetch_add(1, std::memory_order_release);
+        frame_pending_ = false;
+    }
+}
+
+void GridInstance::setKeyMask(uint16_t key_mask)
+{
+    key_mask_.store(key_mask, std::memory_order_relaxed);
+}
+
+uint16_t GridInstance::keyMask() const
+{
+    return key_mask_.load(std::memory_order_relaxed);
+}
+
+uint32_t GridInstance::frameCount() const
+{
+    return frame_count_.load(std::memory_order_acquire);
+}
+
+void GridInstance::copyFrame(uint8_t *out)
+{
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    std::memcpy(out, frame_, sizeof(frame_));
+}
+
+GridScreen::~GridScreen()
+{
+    close();
+}
+
+void GridScreen::close()
+{
+    if (atlas_)
+        SDL_DestroyTexture(atlas_);
+    if (renderer_)
+        SDL_DestroyRenderer(renderer_);
+    if (window_)
+        SDL_DestroyWindow(window_);
+    atlas_ = nullptr;
+    renderer_ = nullptr;
+    window_ = nullptr;
+}
+
+bool GridScreen::setupGraphics(int instance_count, int max_window_width)
+{
+    printf("Setting up grid graphics for %d instances\n", instance_count);
+    count_ = instance_count;
+    columns_ = (int)std::ceil(std::sqrt((double)instance_count));
+    rows_ = (instance_count + columns_ - 1) / columns_;
+    atlas_width_ = columns_ * TILE_WIDTH;
+    atlas_height_ = rows_ * TILE_HEIGHT;
+    scale_ = max_window_width / atlas_width_;
+    if (scale_ < 1)
+        scale_ = 1;
+
+    window_ = SDL_CreateWindow("CHIP-8 grid", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, atlas_width_ * scale_, atlas_height_ * scale_, SDL_WINDOW_OPENGL);
+    if (window_ == NULL)
+    {
+        std::cout << "Error window creation";
+        return false;
+    }
+
+    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (renderer_ == NULL)
+    {
+        std::cout << "Error renderer creation";
+        return false;
+    }
+
+    atlas_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, atlas_width_, atlas_height_);
+    if (atlas_ == NULL)
+    {
+        std::cout << "Error atlas texture creation : " << SDL_GetError();
+        return false;
+    }
+
+    // Blank tiles separated by gap lines, uploaded once; afterwards only dirty tiles move
+    atlas_pixels_.assign(atlas_width_ * atlas_height_, PIXEL_GAP);
+    for (int i = 0; i < count_; i++)
+    {
+        int origin = (i / columns_) * TILE_HEIGHT * atlas_width_ + (i % columns_) * TILE_WIDTH;
+        for (int y = 0; y < SCREEN_HEIGHT; y++)
+            std::fill_n(&atlas_pixels_[origin + y * atlas_width_], SCREEN_WIDTH, PIXEL_OFF);
+    }
+    SDL_UpdateTexture(atlas_, NULL, atlas_pixels_.data(), atlas_width_ * sizeof(uint32_t));
+    seen_frame_.assign(count_, 0);
+    return true;
+}
+
+int GridScreen::drawGraphics(std::vector<std::unique_ptr<GridInstance>> &instances)
+{
+    int uploaded = 0;
+    for (int i = 0; i < count_; i++)
+    {
+        uint32_t frame_count = instances[i]->frameCount();
+        if (frame_count == seen_frame_[i])
+            continue;
+        seen_frame_[i] = frame_count;
+        instances[i]->copyFrame(frame_);
+
+        SDL_Rect tile;
+        tile.x = (i % columns_) * TILE_WIDTH;
+        tile.y = (i / columns_) * TILE_HEIGHT;
+        tile.w = SCREEN_WIDTH;
+        tile.h = SCREEN_HEIGHT;
+        uint32_t *origin = &atlas_pixels_[tile.y * atlas_width_ + tile.x];
+        for (int p = 0; p < SCREEN_WIDTH * SCREEN_HEIGHT; p++)
+            origin[(p / SCREEN_WIDTH) * atlas_width_ + p % SCREEN_WIDTH] = frame_[p] ? PIXEL_ON : PIXEL_OFF;
+        SDL_UpdateTexture(atlas_, &tile, origin, atlas_width_ * sizeof(uint32_t));
+        uploaded++;
+    }
+
+    // Whole grid in one copy, plus an outline around the tile receiving keypad input
+    SDL_RenderCopy(renderer_, atlas_, NULL, NULL);
+    SDL_Rect outline;
+    outline.x = (selected_ % columns_) * TILE_WIDTH * scale_;
+    outline.y = (selected_ / columns_) * TILE_HEIGHT * scale_;
+    outline.w = SCREEN_WIDTH * scale_;
+    outline.h = SCREEN_HEIGHT * scale_;
+    SDL_SetRenderDrawColor(renderer_, 255, 64, 64, 255);
+    SDL_RenderDrawRect(renderer_, &outline);
+    SDL_RenderPresent(renderer_);
+    return uploaded;
+}
+
+int GridScreen::tileAt(int x, int y) const
+{
+    if (x < 0 || y < 0)
+        return -1;
+    int column = x / (TILE_WIDTH * scale_);
+    int row = y / (TILE_HEIGHT * scale_);
+    if (column >= columns_ || row >= rows_)
+        return -1;
+    int i = row * columns_ + column;
+    return i < count_ ? i : -1;
+}
+
+void GridScreen::select(int instance)
+{
+    if (instance >= 0 && instance < count_)
+        selected_ = instance;
+}
+
+int GridScreen::selected() const
+{
+    return selected_;
+}
+
+SDL_Window *GridScreen::window() const
+{
+    return window_;
+}
@@ -0,0 +1,68 @@
+#ifndef GRID_SCREEN_H
+#define GRID_SCREEN_H
+
+#define GRID_TILE_GAP 1 // Separator pixels between tiles in the atlas
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "chip-8.h"
+
+// One emulated machine in the grid. The emulation thread owns chip8 and calls step(); the
+// viewer only touches the published frame and the key mask
+class GridInstance
+{
+    std::mutex frame_mutex_;
+    uint8_t frame_[SCREEN_WIDTH * SCREEN_HEIGHT];
+    std::atomic<uint32_t> frame_count_{0};
+    std::atomic<uint16_t> key_mask_{0};
+    bool frame_pending_ = false;
+
+public:
+    Chip8 chip8;
+
+    void step();                               // Emulation thread: one cycle, then publish the frame if drawn
+    void setKeyMask(uint16_t key_mask);        // Viewer thread
+    uint16_t keyMask() const;                  // Viewer thread
+    uint32_t frameCount() const;               // Viewer thread
+    void copyFrame(uint8_t *out);              // Viewer thread
+};
+
+/*
+    Draws many instances in one window. Every tile lives in a single streaming texture
+    (the atlas); a tile is uploaded only when its instance published a new frame, and the
+    whole grid is drawn with one SDL_RenderCopy.
+*/
+class GridScreen
+{
+    SDL_Window *window_ = nullptr;
+    SDL_Renderer *renderer_ = nullptr;
+    SDL_Texture *atlas_ = nullptr;
+
+    int count_ = 0;
+    int columns_ = 0;
+    int rows_ = 0;
+    int scale_ = 1;
+    int atlas_width_ = 0;
+    int atlas_height_ = 0;
+    int selected_ = 0;
+
+    std::vector<uint32_t> atlas_pixels_; // CPU copy of the atlas, uploaded per dirty tile
+    std::vector<uint32_t> seen_frame_;   // Last frame count uploaded per tile
+    uint8_t frame_[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+public:
+    ~GridScreen();
+    bool setupGraphics(int instance_count, int max_window_width);
+    void close();
+    int drawGraphics(std::vector<std::unique_ptr<GridInstance>> &instances); // Returns the number of tiles uploaded
+    int tileAt(int x, int y) const; // Window coordinates to instance index, -1 outside the grid
+    void select(int instance);
+    int selected() const;
+    SDL_Window *window() const;
+};
+
+#endif /* GRID_SCREEN_H */
@@ -26,9 +26,49 @@ void Screen::drawGraphics(SDL_Renderer* renderer, SDL_Rect* rect, Chip8 chip8)
     }
 }
 
-void Screen::setupGraphics()
+bool Screen::setupGraphics()
 {
     printf("Setting up graphics\n");
+    if (!SDL_WasInit(SDL_INIT_VIDEO) && SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0)
+    {
+        std::cout << "Error SDL2 Initialization : " << SDL_GetError();
+        return false;
+    }
+
+    window_ = SDL_CreateWindow("First program", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 640, SDL_WINDOW_OPENGL);
+    if (window_ == NULL)
+    {
+        std::cout << "Error window creation";
+        return false;
+    }
+
+    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+    if (renderer_ == NULL)
+    {
+        std::cout << "Error renderer creation";
+        return false;
+    }
+    return true;
+}
+
+void Screen::closeGraphics()
+{
+    if (renderer_)
+        SDL_DestroyRenderer(renderer_);
+    if (window_)
+        SDL_DestroyWindow(window_);
+    renderer_ = nullptr;
+    window_ = nullptr;
+}
+
+bool Screen::isOpen() const
+{
+    return renderer_ != nullptr;
+}
+
+SDL_Renderer* Screen::renderer() const
+{
+    return renderer_;
 }
 
 void Screen::setupInput()
@@ -9,10 +9,16 @@
 
 class Screen
 {
+    SDL_Window* window_ = nullptr;
+    SDL_Renderer* renderer_ = nullptr;
+
 public:
-    void setupGraphics();
+    bool setupGraphics(); // Brings up SDL video and opens the window, the core can already run before it
     void setupInput();
+    void closeGraphics();
+    bool isOpen() const;
+    SDL_Renderer* renderer() const;
     void drawGraphics(SDL_Renderer* renderer, SDL_Rect* rect, Chip8 chip8);
 };
 
-#endif /* SCREEN_H */
\ No newline at end of file
+#endif /* SCREEN_H */
@@ -0,0 +1,183 @@
+#include "session.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t stateChecksum(const Chip8State &state)
+{
+    static_assert(sizeof(Chip8State) % 8 == 0, "Chip8State is checksummed in 8 byte words");
+    const uint8_t *bytes = (const uint8_t *)&state;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < sizeof(Chip8State); i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+Session::~Session()
+{
+    close();
+}
+
+SessionStatus Session::open(const char *path, uint64_t rom_hash)
+{
+    printf("Opening session %s...\n", path);
+    fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0)
+    {
+        std::perror("Session file opening failed");
+        return SESSION_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) < 0)
+    {
+        std::perror("Session file stat failed");
+        close();
+        return SESSION_ERROR;
+    }
+
+    // Never clobber a file that exists but is not a session of the right size
+    bool empty = st.st_size == 0;
+    if (!empty && st.st_size != (off_t)sizeof(SessionFile))
+    {
+        printf("Session rejected: unexpected file size %lld\n", (long long)st.st_size);
+        close();
+        return SESSION_ERROR;
+    }
+    if (empty && ftruncate(fd_, sizeof(SessionFile)) < 0)
+    {
+        std::perror("Session file resize failed");
+        close();
+        return SESSION_ERROR;
+    }
+
+    void *map = mmap(NULL, sizeof(SessionFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        std::perror("Session file mapping failed");
+        close();
+        return SESSION_ERROR;
+    }
+    file_ = (SessionFile *)map;
+
+    SessionHeader &header = file_->header;
+    SessionStatus status = SESSION_NEW;
+    if (!empty)
+    {
+        if (std::memcmp(header.magic, SESSION_MAGIC, 4) != 0 || header.version != SESSION_VERSION || header.state_size != sizeof(Chip8State))
+        {
+            printf("Session rejected: not a version %d session file\n", SESSION_VERSION);
+            close();
+            return SESSION_ERROR;
+        }
+        if (header.rom_hash != rom_hash)
+        {
+            printf("Session rejected: saved for a different ROM (0x%016llX)\n", (unsigned long long)header.rom_hash);
+            close();
+            return SESSION_ERROR;
+        }
+        if (header.sequence & 1)
+            printf("Session state was torn by a crash, starting over\n");
+        else if (header.checksum != stateChecksum(file_->state))
+            printf("Session state does not match its checksum (partly written back), starting over\n");
+        else
+            status = SESSION_RESUMED;
+    }
+
+    if (status == SESSION_NEW)
+    {
+        std::memset(file_, 0, sizeof(SessionFile));
+        std::memcpy(header.magic, SESSION_MAGIC, 4);
+        header.version = SESSION_VERSION;
+        header.rom_hash = rom_hash;
+        header.state_size = sizeof(Chip8State);
+        header.sequence = 1; // No valid state until the first save()
+    }
+
+    stop_ = false;
+    sync_thread_ = std::thread(&Session::syncLoop, this);
+    printf(status == SESSION_RESUMED ? "Session resumed!\n" : "Session created!\n");
+    return status;
+}
+
+// Held keys are live input, not machine state: a key down at the last save would otherwise
+// stay pressed until it is pressed and released again
+void Session::restore(Chip8 &chip8) const
+{
+    chip8.setState(file_->state);
+    chip8.setKeys(0);
+}
+
+void Session::save(const Chip8 &chip8)
+{
+    // Sequence is odd for the duration of the copy so a crash mid-write is detected on resume
+    volatile uint32_t &sequence = file_->header.sequence;
+    sequence = (sequence | 1);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    chip8.getState(file_->state);
+    file_->header.checksum = stateChecksum(file_->state);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    sequence = sequence + 1;
+}
+
+void Session::syncLoop()
+{
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    while (!stop_)
+    {
+        sync_cv_.wait_for(lock, std::chrono::milliseconds(SESSION_SYNC_INTERVAL_MS));
+        msync(file_, sizeof(SessionFile), MS_SYNC);
+    }
+}
+
+void Session::close()
+{
+    if (sync_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(sync_mutex_);
+            stop_ = true;
+        }
+        sync_cv_.notify_one();
+        sync_thread_.join();
+    }
+    if (file_)
+    {
+        munmap(file_, sizeof(SessionFile));
+        file_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+uint64_t Session::hashRom(const char *path)
+{
+    // FNV-1a, 64 bit
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    FILE *fp = std::fopen(path, "rb");
+    if (!fp)
+        return hash;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            hash ^= buffer[i];
+            hash *= 0x100000001B3ULL;
+        }
+    }
+    fclose(fp);
+    return hash;
+}
@@ -0,0 +1,75 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#define SESSION_MAGIC "C8SS"
+#define SESSION_VERSION 2
+#define SESSION_SYNC_INTERVAL_MS 1000
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "chip-8.h"
+
+/*
+    *** Session file layout ***
+    0x0000-0x003F - SessionHeader
+    0x0040-...    - Chip8State, exactly as the core exports it
+
+    The file is mapped MAP_SHARED and the state is written through on every cycle, so it
+    survives a crash of the emulator as soon as the write returns. An odd sequence catches
+    a crash in the middle of a save(). After an OS crash or power loss the pages of the file
+    may have been written back from different cycles (the kernel flushes them whenever it
+    likes, not only on the background msync), so the header also keeps a checksum of the
+    state and a mismatch on resume is treated as a torn state.
+*/
+struct SessionHeader
+{
+    char magic[4];       // SESSION_MAGIC
+    uint32_t version;    // SESSION_VERSION
+    uint64_t rom_hash;   // FNV-1a of the ROM the state belongs to
+    uint32_t state_size; // sizeof(Chip8State)
+    uint32_t sequence;   // Odd while a state write is in progress (torn state on resume)
+    uint64_t checksum;   // Of the state, written at the end of every save()
+    uint8_t reserved[32];
+};
+
+struct SessionFile
+{
+    SessionHeader header;
+    Chip8State state;
+};
+
+static_assert(sizeof(SessionHeader) == 64, "SessionHeader layout changed");
+
+enum SessionStatus
+{
+    SESSION_ERROR,   // File could not be used, left untouched
+    SESSION_NEW,     // Fresh session, caller keeps its power-on state
+    SESSION_RESUMED, // State in the file matches the ROM, restore() can be used
+};
+
+class Session
+{
+    int fd_ = -1;
+    SessionFile *file_ = nullptr;
+
+    std::thread sync_thread_;
+    std::mutex sync_mutex_;
+    std::condition_variable sync_cv_;
+    bool stop_ = false;
+
+    void syncLoop();
+
+public:
+    ~Session();
+    SessionStatus open(const char *path, uint64_t rom_hash);
+    void restore(Chip8 &chip8) const;
+    void save(const Chip8 &chip8);
+    void close();
+
+    static uint64_t hashRom(const char *path);
+};
+
+#endif /* SESSION_H */
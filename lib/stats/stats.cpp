@@ -0,0 +1,99 @@
+#include "stats.h"
+
+#include <cinttypes>
+#include <cmath>
+
+static std::string quote(const char *value)
+{
+    std::string out = "\"";
+    for (const char *c = value; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            out += '\\';
+            out += *c;
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)*c);
+            out += buf;
+        }
+        else
+        {
+            out += *c;
+        }
+    }
+    return out + "\"";
+}
+
+Stats::Stats(const char *tool)
+{
+    add("tool", tool);
+}
+
+void Stats::add(const char *name, const char *value)
+{
+    fields_.emplace_back(name, quote(value));
+}
+
+void Stats::add(const char *name, const std::string &value)
+{
+    add(name, value.c_str());
+}
+
+void Stats::add(const char *name, int64_t value)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%" PRId64, value);
+    fields_.emplace_back(name, buf);
+}
+
+void Stats::add(const char *name, uint64_t value)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%" PRIu64, value);
+    fields_.emplace_back(name, buf);
+}
+
+void Stats::add(const char *name, int value)
+{
+    add(name, (int64_t)value);
+}
+
+void Stats::add(const char *name, double value)
+{
+    // JSON has no NaN/Inf, report those as null
+    if (!std::isfinite(value))
+    {
+        fields_.emplace_back(name, "null");
+        return;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    fields_.emplace_back(name, buf);
+}
+
+void Stats::write(FILE *fp) const
+{
+    fputc('{', fp);
+    for (size_t i = 0; i < fields_.size(); i++)
+    {
+        fprintf(fp, "%s%s: %s", i ? ", " : "", quote(fields_[i].first.c_str()).c_str(), fields_[i].second.c_str());
+    }
+    fputs("}\n", fp);
+    fflush(fp);
+}
+
+bool Stats::append(const char *path) const
+{
+    FILE *fp = std::fopen(path, "a");
+    if (!fp)
+    {
+        std::perror("Stats file opening failed");
+        return false;
+    }
+    write(fp);
+    fclose(fp);
+    return true;
+}
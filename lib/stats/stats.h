@@ -0,0 +1,28 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Flat JSON stats record shared by the headless tools. Each record is written as a
+// single line ({"tool": "...", "key": value, ...}) so runs can be appended to one file
+class Stats
+{
+    std::vector<std::pair<std::string, std::string>> fields_;
+
+public:
+    explicit Stats(const char *tool);
+    void add(const char *name, const char *value);
+    void add(const char *name, const std::string &value);
+    void add(const char *name, int64_t value);
+    void add(const char *name, uint64_t value);
+    void add(const char *name, int value);
+    void add(const char *name, double value);
+    void write(FILE *fp) const;
+    bool append(const char *path) const;
+};
+
+#endif /* STATS_H */
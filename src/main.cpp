@@ -1,39 +1,78 @@
 #include "screen.h" // OpenGL graphics and input
 #include "chip-8.h" // Your cpu core implementation
+#include "session.h" // Persistent machine state
+#include "perf.h" // Optional hardware counter instrumentation
+#include "recorder.h" // Optional gameplay recording
 
 #include <SDL2/SDL.h>
+#include <time.h>
 
 constexpr int LOOP_DURATION = 1000 / 120; // 60 FPS 
 
 Screen myScreen;
 Chip8 myChip8;
+Session mySession;
+Recorder myRecorder;
 
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Usage: main [--exit-after-first-instruction] [rom] [session file]
+// --exit-after-first-instruction prints "first_instruction <CLOCK_MONOTONIC ns> <ns since main>"
+// once the first instruction has run and exits, for tools/startup
+// Set CHIP8_PERF=<stats file> to append hardware counter stats for the run loop and rendering on exit.
+// The run section covers the whole loop minus rendering (so also session writes, input and
+// presenting), read once at the start and once at the end: reading the counters around
+// every single cycle would mostly count the reads
+// Set CHIP8_RECORD=<recording file> to record every frame drawn, see tools/c8video
 int main(int argc, char **argv)
 {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
-		std::cout << "Error SDL2 Initialization : " << SDL_GetError();
-		return 1;
-	}
-
-    SDL_Window* window = SDL_CreateWindow("First program", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 640, SDL_WINDOW_OPENGL);
-	if (window == NULL) {
-		std::cout << "Error window creation";
-		return 3;
-	}
-
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-	if (renderer == NULL) {
-		std::cout << "Error renderer creation";
-		return 4;
-	}
-
-    // Set up render system and register input callbacks
-    myScreen.setupGraphics();
+    uint64_t main_start = nowNs();
+    bool exit_after_first_instruction = argc > 1 && !strcmp(argv[1], "--exit-after-first-instruction");
+    int arg = exit_after_first_instruction ? 2 : 1;
+    char *rom_path = argc > arg ? argv[arg] : (char *)"../roms/tetris.ch8";
+    const char *session_path = argc > arg + 1 ? argv[arg + 1] : NULL;
+    const char *perf_path = getenv("CHIP8_PERF");
+    const char *record_path = getenv("CHIP8_RECORD");
+
+    PerfCounters counters;
+    PerfSection run_section("run");
+    PerfSection render_section("render");
+    if (perf_path && !counters.open())
+        std::cout << "Hardware counters unavailable : " << counters.error() << "\n";
+
+    // Register input callbacks, the render system comes up after the first instruction
     myScreen.setupInput();
 
     // Initialize the Chip8 system and load the game into the memory
     myChip8.initialize();     // Clear the memory, registers and screen
-    myChip8.loadGame("../roms/tetris.ch8"); // Copy the program into the memory
+    myChip8.loadGame(rom_path); // Copy the program into the memory
+
+    // Resume from the session file if it holds a state for this ROM
+    if (session_path)
+    {
+        SessionStatus status = mySession.open(session_path, Session::hashRom(rom_path));
+        if (status == SESSION_ERROR)
+        {
+            std::cout << "Error session file " << session_path;
+            return 5;
+        }
+        if (status == SESSION_RESUMED)
+        {
+            mySession.restore(myChip8);
+            myChip8.draw_flag = true;
+        }
+    }
+
+    if (record_path && !myRecorder.open(record_path))
+    {
+        std::cout << "Error recording file " << record_path;
+        return 6;
+    }
 
     SDL_Event e;
     SDL_Rect rect;
@@ -41,9 +80,11 @@ int main(int argc, char **argv)
     rect.y = 50;  // the y coordinate of the rectangle's upper left point
     rect.w = 20; // the width of the rectangle
     rect.h = 20; // the height of the rectangle
-    SDL_RenderPresent(renderer);
     u_int32_t start_tick;
-    
+    uint64_t cycles = 0;
+    if (perf_path)
+        run_section.begin(counters);
+
     // Emulation loop
     for (;;)
     {
@@ -51,11 +92,36 @@ int main(int argc, char **argv)
 
         // Emulate one cycle
         myChip8.emulateCycle();
+        cycles++;
+
+        if (exit_after_first_instruction)
+        {
+            uint64_t first_instruction = nowNs();
+            printf("first_instruction %llu %llu\n", (unsigned long long)first_instruction, (unsigned long long)(first_instruction - main_start));
+            fflush(stdout);
+            break;
+        }
+
+        // SDL video and the window come up right after the first instruction rather than
+        // before it, and not only once something is drawn: a ROM waiting on FX0A before its
+        // first frame still needs the window and its key events
+        if (!myScreen.isOpen() && !myScreen.setupGraphics())
+            return 1;
+
+        // Write the new state through to the session file
+        if (session_path)
+            mySession.save(myChip8);
 
         // If the draw flag is set, update the screen
         if (myChip8.draw_flag) // Only two opcodes should set this flag: 0x00E0 (Clears the screen) and 0xDXYN (Draws a sprite on the screen)
         {
-            myScreen.drawGraphics(renderer, &rect, myChip8);
+            if (perf_path)
+                render_section.begin(counters);
+            myScreen.drawGraphics(myScreen.renderer(), &rect, myChip8);
+            if (perf_path)
+                render_section.end(counters, 0);
+            if (record_path)
+                myRecorder.capture(myChip8.gfx);
             myChip8.draw_flag = false;
         }
 
@@ -78,7 +144,7 @@ int main(int argc, char **argv)
             }
 	    }
 
-		SDL_RenderPresent(renderer);
+		SDL_RenderPresent(myScreen.renderer());
 
         // Ensure loop runs for at least a certain duration
         if (SDL_GetTicks() - start_tick < LOOP_DURATION) {
@@ -86,8 +152,21 @@ int main(int argc, char **argv)
         }
     }
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (perf_path)
+    {
+        run_section.end(counters, cycles);
+        run_section.subtract(render_section);
+        Stats stats("chip8");
+        stats.add("rom", rom_path);
+        stats.add("perf", counters.error().empty() ? "ok" : counters.error());
+        run_section.report(stats, counters);
+        render_section.report(stats, counters);
+        stats.append(perf_path);
+    }
+
+    mySession.close();
+    myRecorder.close();
+    myScreen.closeGraphics();
 	SDL_Quit();
 
     return 0;
@@ -0,0 +1,344 @@
+// Recording tool: prints a summary of a recording made with CHIP8_RECORD, or exports its
+// frames as PNG images or an animated GIF. -s/-e pick a time range in ms, seeking through
+// the keyframe index; -x scales every pixel up.
+//
+// Usage: c8video info recording
+//        c8video png recording out_dir [-s start_ms] [-e end_ms] [-x scale]
+//        c8video gif recording out.gif [-s start_ms] [-e end_ms] [-x scale]
+
+#include "recorder.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void putBe32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 3; i >= 0; i--)
+        out.push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void pngChunk(FILE *fp, const char *type, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> chunk;
+    putBe32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBe32(chunk, crc32(&chunk[4], chunk.size() - 4));
+    std::fwrite(chunk.data(), 1, chunk.size(), fp);
+}
+
+// 8 bit grayscale PNG; the image data uses stored (uncompressed) deflate blocks so no zlib is needed
+static bool writePng(const char *path, const uint8_t *gfx, int scale)
+{
+    int width = SCREEN_WIDTH * scale;
+    int height = SCREEN_HEIGHT * scale;
+    std::vector<uint8_t> raw;
+    for (int y = 0; y < height; y++)
+    {
+        raw.push_back(0); // Filter: none
+        for (int x = 0; x < width; x++)
+            raw.push_back(gfx[(y / scale) * SCREEN_WIDTH + x / scale] ? 0xFF : 0x00);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t pos = 0; pos < raw.size(); pos += 65535)
+    {
+        size_t block = std::min<size_t>(65535, raw.size() - pos);
+        zlib.push_back(pos + block == raw.size()); // BFINAL, BTYPE = stored
+        zlib.push_back(block & 0xFF);
+        zlib.push_back(block >> 8);
+        zlib.push_back(~block & 0xFF);
+        zlib.push_back((~block >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + block);
+    }
+    uint32_t a = 1, b = 0; // Adler-32
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBe32(zlib, (b << 16) | a);
+
+    FILE *fp = std::fopen(path, "wb");
+    if (!fp)
+    {
+        std::perror("PNG file opening failed");
+        return false;
+    }
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::fwrite(signature, 1, sizeof(signature), fp);
+    std::vector<uint8_t> header;
+    putBe32(header, width);
+    putBe32(header, height);
+    header.insert(header.end(), {8, 0, 0, 0, 0}); // 8 bit, grayscale, deflate, no filter, no interlace
+    pngChunk(fp, "IHDR", header);
+    pngChunk(fp, "IDAT", zlib);
+    pngChunk(fp, "IEND", {});
+    fclose(fp);
+    return true;
+}
+
+// Animated GIF with a black/white palette, LZW coded with the minimum code size of 2
+class GifWriter
+{
+    FILE *fp_ = nullptr;
+    int scale_ = 1;
+    std::vector<uint8_t> block_;
+    uint32_t bits_ = 0;
+    int bit_count_ = 0;
+
+    void putBits(uint32_t code, int size)
+    {
+        bits_ |= code << bit_count_;
+        bit_count_ += size;
+        while (bit_count_ >= 8)
+        {
+            putByte(bits_ & 0xFF);
+            bits_ >>= 8;
+            bit_count_ -= 8;
+        }
+    }
+
+    void putByte(uint8_t byte)
+    {
+        block_.push_back(byte);
+        if (block_.size() == 255)
+            flushBlock();
+    }
+
+    void flushBlock()
+    {
+        if (block_.empty())
+            return;
+        fputc((int)block_.size(), fp_);
+        std::fwrite(block_.data(), 1, block_.size(), fp_);
+        block_.clear();
+    }
+
+    void put16(uint16_t value)
+    {
+        fputc(value & 0xFF, fp_);
+        fputc(value >> 8, fp_);
+    }
+
+public:
+    bool open(const char *path, int scale)
+    {
+        fp_ = std::fopen(path, "wb");
+        if (!fp_)
+        {
+            std::perror("GIF file opening failed");
+            return false;
+        }
+        scale_ = scale;
+        std::fwrite("GIF89a", 1, 6, fp_);
+        put16(SCREEN_WIDTH * scale);
+        put16(SCREEN_HEIGHT * scale);
+        const uint8_t screen[] = {0x80, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF}; // Global table of 2 colors: black, white
+        std::fwrite(screen, 1, sizeof(screen), fp_);
+        const uint8_t loop[] = {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+        std::fwrite(loop, 1, sizeof(loop), fp_);
+        return true;
+    }
+
+    void addFrame(const uint8_t *gfx, uint32_t delay_ms)
+    {
+        const uint8_t control[] = {0x21, 0xF9, 0x04, 0x00};
+        std::fwrite(control, 1, sizeof(control), fp_);
+        put16((delay_ms + 5) / 10);
+        fputc(0, fp_);
+        fputc(0, fp_);
+
+        fputc(0x2C, fp_);
+        put16(0);
+        put16(0);
+        put16(SCREEN_WIDTH * scale_);
+        put16(SCREEN_HEIGHT * scale_);
+        fputc(0, fp_);
+
+        const int min_code_size = 2;
+        const int clear = 1 << min_code_size;
+        const int end = clear + 1;
+        fputc(min_code_size, fp_);
+
+        // Dictionary as a trie over the 4 symbols: child[code][symbol], 0 = none
+        static uint16_t child[4096][4];
+        std::memset(child, 0, sizeof(child));
+        int next_code = end + 1;
+        int code_size = min_code_size + 1;
+        putBits(clear, code_size);
+
+        int width = SCREEN_WIDTH * scale_;
+        int height = SCREEN_HEIGHT * scale_;
+        int prefix = -1;
+        for (int p = 0; p < width * height; p++)
+        {
+            int symbol = gfx[((p / width) / scale_) * SCREEN_WIDTH + (p % width) / scale_] ? 1 : 0;
+            if (prefix < 0)
+            {
+                prefix = symbol;
+                continue;
+            }
+            if (child[prefix][symbol])
+            {
+                prefix = child[prefix][symbol];
+                continue;
+            }
+            putBits(prefix, code_size);
+            if (next_code < 4096)
+            {
+                child[prefix][symbol] = next_code++;
+                if (next_code > (1 << code_size) && code_size < 12)
+                    code_size++;
+            }
+            else
+            {
+                putBits(clear, code_size);
+                std::memset(child, 0, sizeof(child));
+                next_code = end + 1;
+                code_size = min_code_size + 1;
+            }
+            prefix = symbol;
+        }
+        putBits(prefix, code_size);
+        putBits(end, code_size);
+        if (bit_count_ > 0)
+            putBits(0, 8 - bit_count_);
+        flushBlock();
+        fputc(0, fp_); // Block terminator
+    }
+
+    void close()
+    {
+        if (!fp_)
+            return;
+        fputc(0x3B, fp_);
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+};
+
+static int info(const char *path)
+{
+    Playback playback;
+    if (!playback.open(path))
+        return 1;
+
+    uint8_t gfx[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint32_t ms = 0;
+    uint32_t frames = 0;
+    while (playback.next(gfx, ms))
+        frames++;
+
+    FILE *fp = std::fopen(path, "rb");
+    std::fseek(fp, 0, SEEK_END);
+    long bytes = std::ftell(fp);
+    fclose(fp);
+
+    Stats stats("c8video");
+    stats.add("recording", path);
+    stats.add("frames", (int)frames);
+    stats.add("keyframes", (int)playback.index().size());
+    stats.add("duration_ms", (int)ms);
+    stats.add("bytes", (int64_t)bytes);
+    stats.add("bytes_per_second", ms ? bytes * 1000.0 / ms : 0.0);
+    stats.add("bytes_per_frame", frames ? (double)bytes / frames : 0.0);
+    stats.write(stdout);
+    return 0;
+}
+
+static int usage(const char *self)
+{
+    fprintf(stderr, "Usage: %s info recording\n", self);
+    fprintf(stderr, "       %s png recording out_dir [-s start_ms] [-e end_ms] [-x scale]\n", self);
+    fprintf(stderr, "       %s gif recording out.gif [-s start_ms] [-e end_ms] [-x scale]\n", self);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && !strcmp(argv[1], "info"))
+        return info(argv[2]);
+    if (argc < 4 || (strcmp(argv[1], "png") && strcmp(argv[1], "gif")))
+        return usage(argv[0]);
+
+    bool gif = !strcmp(argv[1], "gif");
+    const char *out = argv[3];
+    uint32_t start_ms = 0;
+    uint32_t end_ms = UINT32_MAX;
+    int scale = gif ? 4 : 10;
+    for (int i = 4; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            start_ms = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+            end_ms = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-x") && i + 1 < argc)
+            scale = atoi(argv[++i]);
+        else
+            return usage(argv[0]);
+    }
+    if (scale < 1)
+        scale = 1;
+
+    Playback playback;
+    if (!playback.open(argv[2]))
+        return 1;
+    playback.seek(start_ms);
+
+    GifWriter writer;
+    if (gif && !writer.open(out, scale))
+        return 1;
+
+    // Frames before start_ms are decoded (to rebuild the screen) but not exported, except
+    // the last one, which is what was on screen at start_ms
+    uint8_t gfx[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint8_t pending[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint32_t ms, pending_ms = 0, pending_frame = 0;
+    bool has_pending = false;
+    int exported = 0;
+    for (;;)
+    {
+        uint32_t frame = playback.frame();
+        bool more = playback.next(gfx, ms);
+        if (has_pending && (!more || ms > start_ms))
+        {
+            uint32_t shown_from = pending_ms < start_ms ? start_ms : pending_ms;
+            uint32_t shown_until = more ? (ms < end_ms ? ms : end_ms) : shown_from + 100;
+            if (gif)
+            {
+                writer.addFrame(pending, shown_until - shown_from);
+            }
+            else
+            {
+                std::string path = std::string(out) + "/frame_" + std::to_string(pending_frame) + ".png";
+                if (!writePng(path.c_str(), pending, scale))
+                    return 1;
+            }
+            exported++;
+        }
+        if (!more || ms >= end_ms)
+            break;
+        std::memcpy(pending, gfx, sizeof(gfx));
+        pending_ms = ms;
+        pending_frame = frame;
+        has_pending = true;
+    }
+    writer.close();
+    printf("Exported %d frames\n", exported);
+    return 0;
+}
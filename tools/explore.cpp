@@ -0,0 +1,331 @@
+// State-space explorer: breadth-first search over keypad inputs, one frame per step.
+// Every reachable machine state is hashed and kept once; each distinct framebuffer can be
+// exported as a PBM image. States are deduplicated by a 64-bit hash alone, so the search is
+// probabilistic: two distinct states with the same hash count as one (about n^2 / 2^65 odds
+// of any collision for n states, under 1e-7 at the default cap).
+//
+// Usage: explore [-f frames] [-c cycles_per_frame] [-t threads] [-m max_states] [-M frontier_mb] [-p] [-o dir] [-j stats.json] [rom]
+//   -p also tries every pair of held keys, not just single keys
+//   -M caps the memory held by the frontier (the current and next level together)
+
+#include "chip-8.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#define SET_SHARDS 64
+
+// Hash set split into independently locked shards so workers rarely contend
+class ShardedSet
+{
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> hashes;
+    };
+    Shard shards_[SET_SHARDS];
+
+public:
+    bool insert(uint64_t hash) // True if the hash was not there yet
+    {
+        Shard &shard = shards_[hash % SET_SHARDS];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.hashes.insert(hash).second;
+    }
+
+    size_t size()
+    {
+        size_t total = 0;
+        for (auto &shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.hashes.size();
+        }
+        return total;
+    }
+
+    // Buckets plus one heap node (value, next pointer, cached hash) per entry
+    size_t memoryUsage()
+    {
+        size_t bytes = sizeof(*this);
+        for (auto &shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bytes += shard.hashes.bucket_count() * sizeof(void *);
+            bytes += shard.hashes.size() * (sizeof(uint64_t) + 2 * sizeof(void *));
+        }
+        return bytes;
+    }
+};
+
+static uint64_t hashBytes(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 29);
+}
+
+// Held keys, the last opcode and the draw flag are not part of what the game has reached
+static uint64_t stateHash(Chip8State &s)
+{
+    uint8_t key[KEY_NUM];
+    std::memcpy(key, s.key, sizeof(key));
+    uint16_t opcode = s.opcode;
+    uint8_t draw_flag = s.draw_flag;
+
+    std::memset(s.key, 0, sizeof(s.key));
+    s.opcode = 0;
+    s.draw_flag = 0;
+    uint64_t hash = hashBytes(&s, sizeof(s));
+
+    std::memcpy(s.key, key, sizeof(key));
+    s.opcode = opcode;
+    s.draw_flag = draw_flag;
+    return hash;
+}
+
+static void exportFrame(const std::string &dir, uint64_t hash, const uint8_t *gfx)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%016llx.pbm", dir.c_str(), (unsigned long long)hash);
+    FILE *fp = std::fopen(path, "wb");
+    if (!fp)
+    {
+        std::perror("Frame export failed");
+        return;
+    }
+    fprintf(fp, "P4\n%d %d\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i += 8)
+    {
+        uint8_t packed = 0;
+        for (int b = 0; b < 8; b++)
+            packed |= (gfx[i + b] & 1) << (7 - b);
+        fputc(packed, fp);
+    }
+    fclose(fp);
+}
+
+// One level of the search, kept as the per-thread parts it was collected in so a level is
+// never copied into one big vector
+typedef std::vector<std::vector<Chip8State>> Frontier;
+
+static size_t frontierSize(const Frontier &frontier)
+{
+    size_t size = 0;
+    for (auto &part : frontier)
+        size += part.size();
+    return size;
+}
+
+static size_t frontierBytes(const Frontier &frontier)
+{
+    size_t bytes = frontier.capacity() * sizeof(std::vector<Chip8State>);
+    for (auto &part : frontier)
+        bytes += part.capacity() * sizeof(Chip8State);
+    return bytes;
+}
+
+struct Explorer
+{
+    std::vector<uint16_t> inputs;
+    int cycles_per_frame;
+    size_t max_states;
+    std::string export_dir;
+
+    ShardedSet states;
+    ShardedSet frames;
+    std::atomic<size_t> state_count{0};
+    std::atomic<size_t> frame_count{0};
+    std::atomic<uint64_t> expansions{0};
+
+    size_t next_budget;                 // States the next level may hold
+    std::atomic<size_t> next_count{0};  // States collected for the next level so far
+    std::atomic<bool> frontier_full{false};
+
+    // Worker: expands frontier entries until none are left, collecting new states in `next`.
+    // `offsets` holds the index of the first entry of every part, plus the total at the end
+    void expand(const Frontier &frontier, const std::vector<size_t> &offsets, std::atomic<size_t> &cursor, std::vector<Chip8State> &next)
+    {
+        Chip8 chip8;
+        Chip8State s;
+        uint64_t local_expansions = 0;
+        size_t i;
+        while ((i = cursor.fetch_add(1)) < offsets.back() && state_count.load(std::memory_order_relaxed) < max_states && !frontier_full.load(std::memory_order_relaxed))
+        {
+            size_t part = std::upper_bound(offsets.begin(), offsets.end(), i) - offsets.begin() - 1;
+            const Chip8State &from = frontier[part][i - offsets[part]];
+            for (uint16_t input : inputs)
+            {
+                chip8.setState(from);
+                chip8.setKeys(input);
+                for (int c = 0; c < cycles_per_frame; c++)
+                    chip8.emulateCycle();
+                chip8.getState(s);
+                local_expansions++;
+
+                // Room in the next level is taken before the state is marked as seen, so a state
+                // that does not fit is never counted or skipped later
+                if (next_count.fetch_add(1) >= next_budget)
+                {
+                    frontier_full = true;
+                    break;
+                }
+                if (!states.insert(stateHash(s)))
+                {
+                    next_count--;
+                    continue;
+                }
+                state_count++;
+                next.push_back(s);
+
+                uint64_t gfx_hash = hashBytes(s.gfx, sizeof(s.gfx));
+                if (frames.insert(gfx_hash))
+                {
+                    frame_count++;
+                    if (!export_dir.empty())
+                        exportFrame(export_dir, gfx_hash, s.gfx);
+                }
+            }
+        }
+        expansions += local_expansions;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    int max_frames = 60;
+    int threads = std::thread::hardware_concurrency();
+    size_t frontier_mb = 1024;
+    bool pairs = false;
+    const char *stats_path = NULL;
+    char *rom_path = (char *)"../roms/tetris.ch8";
+
+    Explorer explorer;
+    explorer.cycles_per_frame = 10;
+    explorer.max_states = 1000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            max_frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            explorer.cycles_per_frame = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+            explorer.max_states = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-M") && i + 1 < argc)
+            frontier_mb = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-p"))
+            pairs = true;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            explorer.export_dir = argv[++i];
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            stats_path = argv[++i];
+        else if (argv[i][0] != '-')
+            rom_path = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [-f frames] [-c cycles_per_frame] [-t threads] [-m max_states] [-M frontier_mb] [-p] [-o dir] [-j stats.json] [rom]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+
+    // No key, every single key, and optionally every pair of keys
+    explorer.inputs.push_back(0);
+    for (int a = 0; a < KEY_NUM; a++)
+        explorer.inputs.push_back(1 << a);
+    if (pairs)
+        for (int a = 0; a < KEY_NUM; a++)
+            for (int b = a + 1; b < KEY_NUM; b++)
+                explorer.inputs.push_back((1 << a) | (1 << b));
+
+    Chip8 chip8;
+    chip8.initialize();
+    chip8.loadGame(rom_path);
+
+    Frontier frontier(1, std::vector<Chip8State>(1));
+    chip8.getState(frontier[0][0]);
+    frontier[0][0].rng_state = 1; // Fixed CXNN sequence so runs are repeatable
+    explorer.states.insert(stateHash(frontier[0][0]));
+    explorer.state_count = 1;
+
+    // Both the level being expanded and the one being collected are held at the same time,
+    // and a vector that grows by doubling can have up to twice the capacity it uses
+    size_t max_frontier_states = frontier_mb * 1024 * 1024 / (2 * sizeof(Chip8State));
+    size_t frontier_size = 1;
+    size_t peak_frontier = 1;
+    size_t peak_frontier_bytes = frontierBytes(frontier);
+    int depth = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (; depth < max_frames && frontier_size > 0 && explorer.state_count < explorer.max_states && !explorer.frontier_full; depth++)
+    {
+        std::vector<size_t> offsets(1, 0);
+        for (auto &part : frontier)
+            offsets.push_back(offsets.back() + part.size());
+        explorer.next_budget = max_frontier_states > frontier_size ? max_frontier_states - frontier_size : 0;
+        explorer.next_count = 0;
+
+        std::atomic<size_t> cursor{0};
+        Frontier next(threads);
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++)
+            pool.emplace_back(&Explorer::expand, &explorer, std::cref(frontier), std::cref(offsets), std::ref(cursor), std::ref(next[t]));
+        for (auto &t : pool)
+            t.join();
+
+        peak_frontier_bytes = std::max(peak_frontier_bytes, frontierBytes(frontier) + frontierBytes(next));
+        frontier = std::move(next);
+        frontier_size = frontierSize(frontier);
+        peak_frontier = std::max(peak_frontier, frontier_size);
+
+        fprintf(stderr, "Frame %d: %zu new states, %zu total, %zu distinct screens\n", depth + 1, frontier_size, explorer.state_count.load(), explorer.frame_count.load());
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t state_count = explorer.state_count;
+    size_t set_bytes = explorer.states.memoryUsage();
+    Stats stats("explore");
+    stats.add("rom", rom_path);
+    stats.add("threads", threads);
+    stats.add("inputs", (int)explorer.inputs.size());
+    stats.add("cycles_per_frame", explorer.cycles_per_frame);
+    stats.add("frames", depth);
+    stats.add("seconds", elapsed);
+    stats.add("expansions", explorer.expansions.load());
+    stats.add("states", (uint64_t)state_count);
+    stats.add("distinct_screens", (uint64_t)explorer.frame_count.load());
+    stats.add("states_per_second", state_count / elapsed);
+    stats.add("expansions_per_second", explorer.expansions.load() / elapsed);
+    stats.add("dedup_bytes_per_state", (double)set_bytes / state_count);
+    stats.add("frontier_bytes_per_state", (int)sizeof(Chip8State));
+    stats.add("peak_frontier", (uint64_t)peak_frontier);
+    stats.add("peak_frontier_bytes", (uint64_t)peak_frontier_bytes);
+    stats.add("peak_frontier_bytes_per_state", (double)peak_frontier_bytes / state_count);
+    stats.add("max_frontier_mb", (uint64_t)frontier_mb);
+    stats.add("truncated", explorer.frontier_full ? "max_frontier_mb" : explorer.state_count >= explorer.max_states ? "max_states" : "no");
+    stats.write(stdout);
+    if (stats_path)
+        stats.append(stats_path);
+
+    return 0;
+}
@@ -0,0 +1,571 @@
+// Differential fuzzer: runs random machine states and instruction streams through the
+// production core (Chip8::emulateCycle) and an independent reference model, and reduces
+// every divergence to a single-instruction reproducer.
+//
+// Usage: fuzz [-t threads] [-d seconds] [-n steps_per_case] [-s seed] [-o stats.json]
+// Exits with status 1 if any divergence was found.
+
+#include "chip-8.h"
+#include "stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+struct Rng
+{
+    uint64_t s;
+
+    uint64_t next() // xorshift64*
+    {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+
+    uint32_t below(uint32_t n)
+    {
+        return (uint32_t)(((next() >> 32) * n) >> 32);
+    }
+};
+
+/*
+    Reference model, written straight from the opcode table at the end of chip-8.cpp and
+    kept deliberately naive. Conventions it shares with the production core:
+    - memory accesses and the opcode fetch wrap at 0xFFF
+    - VF is written after the result, so 8FYN leaves the flag in VF
+    - DXYN wraps around the screen edges, FX29 points into the font set at 0x000
+    - 2NNN on a full stack and 00EE on an empty one are skipped
+    - unknown opcodes do not advance PC
+    - both timers tick once per instruction
+*/
+static void referenceStep(Chip8State &s)
+{
+    uint16_t op = (s.memory[s.program_counter & 0xFFF] << 8) | s.memory[(s.program_counter + 1) & 0xFFF];
+    uint8_t x = (op >> 8) & 0xF;
+    uint8_t y = (op >> 4) & 0xF;
+    uint8_t n = op & 0xF;
+    uint8_t nn = op & 0xFF;
+    uint16_t nnn = op & 0xFFF;
+    uint8_t *v = s.gen_purpose_reg_v;
+    uint16_t next = s.program_counter + 2;
+    uint16_t skip = s.program_counter + 4;
+
+    s.opcode = op;
+
+    switch (op >> 12)
+    {
+    case 0x0:
+        if (op == 0x00E0)
+        {
+            std::memset(s.gfx, 0, sizeof(s.gfx));
+            s.draw_flag = 1;
+            s.program_counter = next;
+        }
+        else if (op == 0x00EE)
+        {
+            if (s.stack_pointer >= 1 && s.stack_pointer <= STACK_SIZE)
+                s.program_counter = s.stack[--s.stack_pointer] + 2;
+            else
+                s.program_counter = next;
+        }
+        break;
+    case 0x1:
+        s.program_counter = nnn;
+        break;
+    case 0x2:
+        if (s.stack_pointer < STACK_SIZE)
+        {
+            s.stack[s.stack_pointer++] = s.program_counter;
+            s.program_counter = nnn;
+        }
+        else
+        {
+            s.program_counter = next;
+        }
+        break;
+    case 0x3:
+        s.program_counter = v[x] == nn ? skip : next;
+        break;
+    case 0x4:
+        s.program_counter = v[x] != nn ? skip : next;
+        break;
+    case 0x5:
+        s.program_counter = v[x] == v[y] ? skip : next;
+        break;
+    case 0x6:
+        v[x] = nn;
+        s.program_counter = next;
+        break;
+    case 0x7:
+        v[x] = v[x] + nn;
+        s.program_counter = next;
+        break;
+    case 0x8:
+    {
+        uint8_t a = v[x];
+        uint8_t b = v[y];
+        bool known = true;
+        switch (n)
+        {
+        case 0x0: v[x] = b; break;
+        case 0x1: v[x] = a | b; break;
+        case 0x2: v[x] = a & b; break;
+        case 0x3: v[x] = a ^ b; break;
+        case 0x4: v[x] = a + b; v[0xF] = (a + b) > 0xFF; break;
+        case 0x5: v[x] = a - b; v[0xF] = a >= b; break;
+        case 0x6: v[x] = a >> 1; v[0xF] = a & 1; break;
+        case 0x7: v[x] = b - a; v[0xF] = b >= a; break;
+        case 0xE: v[x] = a << 1; v[0xF] = a >> 7; break;
+        default: known = false; break;
+        }
+        if (known)
+            s.program_counter = next;
+    }
+    break;
+    case 0x9:
+        s.program_counter = v[x] != v[y] ? skip : next;
+        break;
+    case 0xA:
+        s.index_register = nnn;
+        s.program_counter = next;
+        break;
+    case 0xB:
+        s.program_counter = nnn + v[0];
+        break;
+    case 0xC:
+        s.rng_state ^= s.rng_state << 13;
+        s.rng_state ^= s.rng_state >> 17;
+        s.rng_state ^= s.rng_state << 5;
+        v[x] = s.rng_state & nn;
+        s.program_counter = next;
+        break;
+    case 0xD:
+    {
+        uint8_t x0 = v[x] % SCREEN_WIDTH;
+        uint8_t y0 = v[y] % SCREEN_HEIGHT;
+        uint8_t collision = 0;
+        for (int row = 0; row < n; row++)
+        {
+            uint8_t bits = s.memory[(s.index_register + row) & 0xFFF];
+            for (int col = 0; col < 8; col++)
+            {
+                if (bits & (0x80 >> col))
+                {
+                    uint8_t &pixel = s.gfx[((y0 + row) % SCREEN_HEIGHT) * SCREEN_WIDTH + (x0 + col) % SCREEN_WIDTH];
+                    collision |= pixel;
+                    pixel ^= 1;
+                }
+            }
+        }
+        v[0xF] = collision;
+        s.draw_flag = 1;
+        s.program_counter = next;
+    }
+    break;
+    case 0xE:
+        if (nn == 0x9E)
+            s.program_counter = s.key[v[x] & 0xF] ? skip : next;
+        else if (nn == 0xA1)
+            s.program_counter = s.key[v[x] & 0xF] ? next : skip;
+        break;
+    case 0xF:
+        switch (nn)
+        {
+        case 0x07: v[x] = s.delay_timer; s.program_counter = next; break;
+        case 0x0A:
+            for (int k = 0; k < KEY_NUM; k++)
+            {
+                if (s.key[k])
+                {
+                    v[x] = k;
+                    s.program_counter = next;
+                    break;
+                }
+            }
+            break;
+        case 0x15: s.delay_timer = v[x]; s.program_counter = next; break;
+        case 0x18: s.sound_timer = v[x]; s.program_counter = next; break;
+        case 0x1E: s.index_register += v[x]; s.program_counter = next; break;
+        case 0x29: s.index_register = (v[x] & 0xF) * 5; s.program_counter = next; break;
+        case 0x33:
+            s.memory[s.index_register & 0xFFF] = v[x] / 100;
+            s.memory[(s.index_register + 1) & 0xFFF] = v[x] / 10 % 10;
+            s.memory[(s.index_register + 2) & 0xFFF] = v[x] % 10;
+            s.program_counter = next;
+            break;
+        case 0x55:
+            for (int i = 0; i <= x; i++)
+                s.memory[(s.index_register + i) & 0xFFF] = v[i];
+            s.program_counter = next;
+            break;
+        case 0x65:
+            for (int i = 0; i <= x; i++)
+                v[i] = s.memory[(s.index_register + i) & 0xFFF];
+            s.program_counter = next;
+            break;
+        }
+        break;
+    }
+
+    if (s.delay_timer > 0)
+        --s.delay_timer;
+    if (s.sound_timer > 0)
+        --s.sound_timer;
+}
+
+// Mostly well-formed opcodes so every instruction gets exercised, with some raw noise
+static uint16_t randomOpcode(Rng &rng)
+{
+    static const uint8_t alu_ops[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+    static const uint8_t misc_ops[] = {0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65};
+
+    uint64_t r = rng.next();
+    uint16_t op = r & 0xFFFF;
+    if (rng.below(16) == 0)
+        return op;
+
+    switch (op >> 12)
+    {
+    case 0x0:
+        return (r >> 16) & 1 ? 0x00E0 : 0x00EE;
+    case 0x5:
+    case 0x9:
+        return op & 0xFFF0;
+    case 0x8:
+        return (op & 0xFFF0) | alu_ops[rng.below(sizeof(alu_ops))];
+    case 0xE:
+        return (op & 0xFF00) | ((r >> 16) & 1 ? 0x9E : 0xA1);
+    case 0xF:
+        return (op & 0xFF00) | misc_ops[rng.below(sizeof(misc_ops))];
+    default:
+        return op;
+    }
+}
+
+// Random registers, stack, keys and timers, with `steps` fresh opcodes written at PC.
+// Memory and gfx keep whatever earlier cases left there unless refreshed
+static void randomizeState(Rng &rng, Chip8State &s, int steps, bool refresh)
+{
+    if (refresh)
+    {
+        for (size_t i = 0; i < sizeof(s.memory); i += 8)
+        {
+            uint64_t r = rng.next();
+            std::memcpy(&s.memory[i], &r, 8);
+        }
+        for (size_t i = 0; i < sizeof(s.gfx); i++)
+            s.gfx[i] = rng.below(4) == 0;
+    }
+
+    for (int i = 0; i < GPREG_NUM; i++)
+        s.gen_purpose_reg_v[i] = rng.below(4) == 0 ? rng.below(4) * 0x3F + rng.below(2) : rng.next() & 0xFF;
+    for (int i = 0; i < STACK_SIZE; i++)
+        s.stack[i] = rng.next() & 0xFFF;
+    for (int i = 0; i < KEY_NUM; i++)
+        s.key[i] = rng.below(8) == 0;
+
+    s.opcode = 0;
+    s.index_register = rng.below(8) == 0 ? rng.next() & 0xFFFF : rng.next() & 0xFFF;
+    s.program_counter = rng.next() & 0xFFE;
+    s.stack_pointer = rng.below(STACK_SIZE + 1);
+    s.rng_state = (uint32_t)rng.next() | 1;
+    s.delay_timer = rng.below(4) == 0 ? rng.next() & 0xFF : rng.below(3);
+    s.sound_timer = rng.below(4) == 0 ? rng.next() & 0xFF : rng.below(3);
+    s.draw_flag = 0;
+    s.reserved = 0;
+
+    for (int i = 0; i < steps; i++)
+    {
+        uint16_t op = randomOpcode(rng);
+        s.memory[(s.program_counter + 2 * i) & 0xFFF] = op >> 8;
+        s.memory[(s.program_counter + 2 * i + 1) & 0xFFF] = op & 0xFF;
+    }
+}
+
+static bool sameState(const Chip8State &a, const Chip8State &b)
+{
+    return std::memcmp(&a, &b, sizeof(Chip8State)) == 0;
+}
+
+// Runs `steps` instructions on both models from `initial`, leaving the results in `core` and `ref`
+static void runBoth(Chip8 &chip8, const Chip8State &initial, int steps, Chip8State &core, Chip8State &ref)
+{
+    chip8.setState(initial);
+    ref = initial;
+    for (int i = 0; i < steps; i++)
+    {
+        chip8.emulateCycle();
+        referenceStep(ref);
+    }
+    chip8.getState(core);
+}
+
+static bool diverges(Chip8 &chip8, const Chip8State &initial, int steps)
+{
+    static thread_local Chip8State core, ref;
+    runBoth(chip8, initial, steps, core, ref);
+    return !sameState(core, ref);
+}
+
+// Zeroes `count` fields if the single-step divergence survives it
+template <typename T>
+static void tryZero(Chip8 &chip8, Chip8State &s, T *field, size_t count)
+{
+    std::vector<uint8_t> saved((uint8_t *)field, (uint8_t *)(field + count));
+    std::memset(field, 0, count * sizeof(T));
+    if (!diverges(chip8, s, 1))
+        std::memcpy(field, saved.data(), saved.size());
+}
+
+static bool inChunk(long index, size_t begin, size_t end)
+{
+    return index >= (long)begin && index < (long)end;
+}
+
+// Bisects a byte array down to the bytes that matter, never touching bytes keep_a and keep_b
+// (-1 for none)
+static void shrinkBytes(Chip8 &chip8, Chip8State &s, uint8_t *bytes, size_t size, long keep_a, long keep_b)
+{
+    for (size_t chunk = size; chunk >= 1; chunk /= 2)
+    {
+        for (size_t begin = 0; begin < size; begin += chunk)
+        {
+            if (inChunk(keep_a, begin, begin + chunk) || inChunk(keep_b, begin, begin + chunk))
+                continue;
+            tryZero(chip8, s, bytes + begin, chunk);
+        }
+    }
+}
+
+// Returns the machine state just before the first instruction whose result differs
+static Chip8State firstDivergence(Chip8 &chip8, const Chip8State &initial, int steps)
+{
+    Chip8State before = initial, core, ref;
+
+    chip8.setState(initial);
+    for (int i = 0; i < steps; i++)
+    {
+        chip8.emulateCycle();
+        ref = before;
+        referenceStep(ref);
+        chip8.getState(core);
+        if (!sameState(core, ref))
+            break;
+        before = ref;
+    }
+    return before;
+}
+
+// Reduces a single-instruction divergence by clearing every byte that does not affect it
+static Chip8State minimize(Chip8 &chip8, const Chip8State &before)
+{
+    Chip8State s = before;
+    // Both opcode bytes stay, at 0xFFF and 0x000 when the opcode straddles the wrap
+    long pc = s.program_counter & 0xFFF;
+    shrinkBytes(chip8, s, s.memory, sizeof(s.memory), pc, (pc + 1) & 0xFFF);
+    shrinkBytes(chip8, s, s.gfx, sizeof(s.gfx), -1, -1);
+    for (int i = 0; i < GPREG_NUM; i++)
+        tryZero(chip8, s, &s.gen_purpose_reg_v[i], 1);
+    for (int i = 0; i < STACK_SIZE; i++)
+        tryZero(chip8, s, &s.stack[i], 1);
+    for (int i = 0; i < KEY_NUM; i++)
+        tryZero(chip8, s, &s.key[i], 1);
+    tryZero(chip8, s, &s.index_register, 1);
+    tryZero(chip8, s, &s.stack_pointer, 1);
+    tryZero(chip8, s, &s.delay_timer, 1);
+    tryZero(chip8, s, &s.sound_timer, 1);
+    return s;
+}
+
+static void printReproducer(Chip8 &chip8, const Chip8State &s)
+{
+    Chip8State core, ref;
+    runBoth(chip8, s, 1, core, ref);
+
+    printf("Divergence on opcode 0x%04X\n", ref.opcode);
+    printf("  initial: PC=0x%03X I=0x%04X SP=%d DT=%d ST=%d", s.program_counter, s.index_register, s.stack_pointer, s.delay_timer, s.sound_timer);
+    for (int i = 0; i < GPREG_NUM; i++)
+        if (s.gen_purpose_reg_v[i])
+            printf(" V%X=0x%02X", i, s.gen_purpose_reg_v[i]);
+    for (int i = 0; i < STACK_SIZE; i++)
+        if (s.stack[i])
+            printf(" stack[%d]=0x%03X", i, s.stack[i]);
+    for (int i = 0; i < KEY_NUM; i++)
+        if (s.key[i])
+            printf(" key[%X]", i);
+    for (int i = 0; i < MEM_SIZE; i++)
+        if (s.memory[i] && i != (s.program_counter & 0xFFF) && i != ((s.program_counter + 1) & 0xFFF))
+            printf(" mem[0x%03X]=0x%02X", i, s.memory[i]);
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        if (s.gfx[i])
+            printf(" gfx[%d]", i);
+    printf("\n");
+
+    for (int i = 0; i < MEM_SIZE; i++)
+        if (core.memory[i] != ref.memory[i])
+            printf("  mem[0x%03X]: core=0x%02X reference=0x%02X\n", i, core.memory[i], ref.memory[i]);
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        if (core.gfx[i] != ref.gfx[i])
+            printf("  gfx[%d]: core=%d reference=%d\n", i, core.gfx[i], ref.gfx[i]);
+    for (int i = 0; i < STACK_SIZE; i++)
+        if (core.stack[i] != ref.stack[i])
+            printf("  stack[%d]: core=0x%03X reference=0x%03X\n", i, core.stack[i], ref.stack[i]);
+    for (int i = 0; i < GPREG_NUM; i++)
+        if (core.gen_purpose_reg_v[i] != ref.gen_purpose_reg_v[i])
+            printf("  V%X: core=0x%02X reference=0x%02X\n", i, core.gen_purpose_reg_v[i], ref.gen_purpose_reg_v[i]);
+    for (int i = 0; i < KEY_NUM; i++)
+        if (core.key[i] != ref.key[i])
+            printf("  key[%X]: core=%d reference=%d\n", i, core.key[i], ref.key[i]);
+    if (core.opcode != ref.opcode)
+        printf("  opcode: core=0x%04X reference=0x%04X\n", core.opcode, ref.opcode);
+    if (core.program_counter != ref.program_counter)
+        printf("  PC: core=0x%03X reference=0x%03X\n", core.program_counter, ref.program_counter);
+    if (core.index_register != ref.index_register)
+        printf("  I: core=0x%04X reference=0x%04X\n", core.index_register, ref.index_register);
+    if (core.stack_pointer != ref.stack_pointer)
+        printf("  SP: core=%d reference=%d\n", core.stack_pointer, ref.stack_pointer);
+    if (core.rng_state != ref.rng_state)
+        printf("  rng: core=0x%08X reference=0x%08X\n", core.rng_state, ref.rng_state);
+    if (core.delay_timer != ref.delay_timer || core.sound_timer != ref.sound_timer)
+        printf("  DT/ST: core=%d/%d reference=%d/%d\n", core.delay_timer, core.sound_timer, ref.delay_timer, ref.sound_timer);
+    if (core.draw_flag != ref.draw_flag)
+        printf("  draw_flag: core=%d reference=%d\n", core.draw_flag, ref.draw_flag);
+    if (core.reserved != ref.reserved)
+        printf("  reserved: core=%d reference=%d\n", core.reserved, ref.reserved);
+}
+
+// Opcode shape used to report each distinct bug once (X, Y and immediates dropped)
+static uint16_t signature(uint16_t op)
+{
+    switch (op >> 12)
+    {
+    case 0x0:
+        return op;
+    case 0x8:
+        return op & 0xF00F;
+    case 0xE:
+    case 0xF:
+        return op & 0xF0FF;
+    default:
+        return op & 0xF000;
+    }
+}
+
+struct Shared
+{
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> cases{0};
+    std::atomic<uint64_t> instructions{0};
+    std::atomic<uint64_t> divergences{0};
+    std::mutex report_mutex;
+    std::set<uint16_t> reported;
+};
+
+static void worker(Shared &shared, uint64_t seed, int steps)
+{
+    Rng rng{seed};
+    Chip8 chip8;
+    chip8.initialize();
+    Chip8State initial, core, ref;
+    std::memset(&initial, 0, sizeof(initial));
+
+    uint64_t cases = 0;
+    while (!shared.stop.load(std::memory_order_relaxed))
+    {
+        randomizeState(rng, initial, steps, cases % 1024 == 0);
+        runBoth(chip8, initial, steps, core, ref);
+        cases++;
+
+        if (!sameState(core, ref))
+        {
+            // Only the first case of each opcode shape is minimized, the rest are just counted
+            shared.divergences++;
+            Chip8State before = firstDivergence(chip8, initial, steps);
+            uint16_t op = (before.memory[before.program_counter & 0xFFF] << 8) | before.memory[(before.program_counter + 1) & 0xFFF];
+            bool first;
+            {
+                std::lock_guard<std::mutex> lock(shared.report_mutex);
+                first = shared.reported.insert(signature(op)).second;
+            }
+            if (first)
+            {
+                Chip8State repro = minimize(chip8, before);
+                std::lock_guard<std::mutex> lock(shared.report_mutex);
+                printReproducer(chip8, repro);
+            }
+        }
+
+        if (cases % 256 == 0)
+        {
+            shared.cases += 256;
+            shared.instructions += 256ULL * steps;
+        }
+    }
+    shared.cases += cases % 256;
+    shared.instructions += (cases % 256) * steps;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = std::thread::hardware_concurrency();
+    double seconds = 10;
+    int steps = 64;
+    uint64_t seed = (uint64_t)time(NULL);
+    const char *stats_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            stats_path = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [-t threads] [-d seconds] [-n steps_per_case] [-s seed] [-o stats.json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+    if (steps < 1)
+        steps = 1;
+
+    Shared shared;
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; i++)
+        pool.emplace_back(worker, std::ref(shared), seed * 0x9E3779B97F4A7C15ULL + i + 1, steps);
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    shared.stop = true;
+    for (auto &t : pool)
+        t.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Stats stats("fuzz");
+    stats.add("seed", seed);
+    stats.add("threads", threads);
+    stats.add("steps_per_case", steps);
+    stats.add("seconds", elapsed);
+    stats.add("cases", shared.cases.load());
+    stats.add("instructions", shared.instructions.load());
+    stats.add("instructions_per_second", shared.instructions.load() / elapsed);
+    stats.add("divergences", shared.divergences.load());
+    stats.add("distinct_divergences", (uint64_t)shared.reported.size());
+    stats.write(stdout);
+    if (stats_path)
+        stats.append(stats_path);
+
+    return shared.divergences.load() ? 1 : 0;
+}
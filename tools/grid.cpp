@@ -0,0 +1,152 @@
+// Grid viewer: runs many instances of one ROM on background threads and shows them all in
+// one window. Click a tile to route the keypad to that instance.
+//
+// Usage: grid [-n instances] [-t threads] [-c cycles_per_second] [rom]
+
+#include "chip-8.h"
+#include "grid-screen.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define MAX_WINDOW_WIDTH 1280
+#define TICKS_PER_SECOND 60
+
+static std::atomic<bool> stop{false};
+
+// Runs instances [begin, end) at cycles_per_second each, in 60 Hz batches
+static void emulate(std::vector<std::unique_ptr<GridInstance>> &instances, int begin, int end, int cycles_per_second)
+{
+    int cycles_per_tick = cycles_per_second / TICKS_PER_SECOND;
+    if (cycles_per_tick < 1)
+        cycles_per_tick = 1;
+    auto tick = std::chrono::microseconds(1000000 / TICKS_PER_SECOND);
+    auto next = std::chrono::steady_clock::now();
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        for (int i = begin; i < end; i++)
+            for (int c = 0; c < cycles_per_tick; c++)
+                instances[i]->step();
+
+        next += tick;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int count = 16;
+    int threads = std::thread::hardware_concurrency();
+    int cycles_per_second = 600;
+    char *rom_path = (char *)"../roms/tetris.ch8";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            cycles_per_second = atoi(argv[++i]);
+        else if (argv[i][0] != '-')
+            rom_path = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [-n instances] [-t threads] [-c cycles_per_second] [rom]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1)
+        count = 1;
+    if (threads < 1)
+        threads = 1;
+    if (threads > count)
+        threads = count;
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0)
+    {
+        std::cout << "Error SDL2 Initialization : " << SDL_GetError();
+        return 1;
+    }
+
+    // Same ROM everywhere, but each instance gets its own CXNN sequence
+    std::vector<std::unique_ptr<GridInstance>> instances;
+    Chip8State state;
+    for (int i = 0; i < count; i++)
+    {
+        instances.emplace_back(new GridInstance());
+        Chip8 &chip8 = instances.back()->chip8;
+        chip8.initialize();
+        chip8.loadGame(rom_path);
+        chip8.getState(state);
+        state.rng_state = (state.rng_state + i * 0x9E3779B9u) | 1;
+        chip8.setState(state);
+    }
+
+    GridScreen grid;
+    if (!grid.setupGraphics(count, MAX_WINDOW_WIDTH))
+        return 3;
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back(emulate, std::ref(instances), count * t / threads, count * (t + 1) / threads, cycles_per_second);
+
+    SDL_Event e;
+    int frames = 0;
+    int uploads = 0;
+    uint32_t second_start = SDL_GetTicks();
+    while (!stop)
+    {
+        while (SDL_PollEvent(&e))
+        {
+            if (e.type == SDL_QUIT)
+            {
+                stop = true;
+            }
+            else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT)
+            {
+                int tile = grid.tileAt(e.button.x, e.button.y);
+                if (tile >= 0 && tile != grid.selected())
+                {
+                    instances[grid.selected()]->setKeyMask(0); // Release whatever was held on the old tile
+                    grid.select(tile);
+                }
+            }
+            else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+            {
+                int key = Chip8::keyIndex(e.key.keysym.sym);
+                if (key >= 0)
+                {
+                    GridInstance &instance = *instances[grid.selected()];
+                    uint16_t mask = instance.keyMask();
+                    if (e.type == SDL_KEYDOWN)
+                        mask |= 1 << key;
+                    else
+                        mask &= ~(1 << key);
+                    instance.setKeyMask(mask);
+                }
+            }
+        }
+
+        uploads += grid.drawGraphics(instances); // Paced by vsync
+        frames++;
+
+        if (SDL_GetTicks() - second_start >= 1000)
+        {
+            char title[128];
+            snprintf(title, sizeof(title), "CHIP-8 grid - %d instances - %d FPS - %d tile uploads/s", count, frames, uploads);
+            SDL_SetWindowTitle(grid.window(), title);
+            frames = 0;
+            uploads = 0;
+            second_start = SDL_GetTicks();
+        }
+    }
+
+    for (auto &t : pool)
+        t.join();
+    grid.close();
+    SDL_Quit();
+    return 0;
+}
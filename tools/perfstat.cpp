@@ -0,0 +1,124 @@
+// Hardware counter profile of the CPU core: runs each ROM headless for a number of frames
+// and reports IPC and misses per guest instruction for the whole run loop and for the
+// DXYN cycles on their own, one JSON stats line per ROM (and per frame with -F). The run
+// loop, DXYN and per-frame numbers come from separate passes over the same frames.
+//
+// Usage: perfstat [-f frames] [-c cycles_per_frame] [-F] [-j stats.json] rom...
+
+#include "chip-8.h"
+#include "perf.h"
+#include "stats.h"
+
+#include <vector>
+
+static void emit(const Stats &stats, const char *stats_path)
+{
+    stats.write(stdout);
+    if (stats_path)
+        stats.append(stats_path);
+}
+
+int main(int argc, char **argv)
+{
+    int frames = 600;
+    int cycles_per_frame = 10;
+    bool per_frame = false;
+    const char *stats_path = NULL;
+    std::vector<char *> roms;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            cycles_per_frame = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-F"))
+            per_frame = true;
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            stats_path = argv[++i];
+        else if (argv[i][0] != '-')
+            roms.push_back(argv[i]);
+        else
+        {
+            roms.clear();
+            break;
+        }
+    }
+    if (roms.empty())
+    {
+        fprintf(stderr, "Usage: %s [-f frames] [-c cycles_per_frame] [-F] [-j stats.json] rom...\n", argv[0]);
+        return 2;
+    }
+
+    PerfCounters counters;
+    if (!counters.open())
+        fprintf(stderr, "Hardware counters unavailable (%s), reporting wall-clock only\n", counters.error().c_str());
+    else if (!counters.error().empty())
+        fprintf(stderr, "Some hardware counters unavailable (%s)\n", counters.error().c_str());
+
+    for (char *rom : roms)
+    {
+        Chip8 chip8;
+        chip8.initialize();
+        chip8.loadGame(rom);
+        Chip8State start;
+        chip8.getState(start);
+        start.rng_state = 1; // Same CXNN sequence on every pass and every run
+        uint64_t cycles = (uint64_t)frames * cycles_per_frame;
+
+        // Each section gets its own pass from the same start state, so no section has another
+        // one's counter reads nested inside it
+        PerfSection run("run");
+        chip8.setState(start);
+        run.begin(counters);
+        for (uint64_t c = 0; c < cycles; c++)
+            chip8.emulateCycle();
+        run.end(counters, cycles);
+
+        PerfSection dxyn("dxyn");
+        chip8.setState(start);
+        for (uint64_t c = 0; c < cycles; c++)
+        {
+            if ((chip8.nextOpcode() & 0xF000) == 0xD000)
+            {
+                dxyn.begin(counters);
+                chip8.emulateCycle();
+                dxyn.end(counters, 1);
+            }
+            else
+            {
+                chip8.emulateCycle();
+            }
+        }
+
+        if (per_frame)
+        {
+            PerfSection frame("frame");
+            chip8.setState(start);
+            for (int f = 0; f < frames; f++)
+            {
+                frame.reset();
+                frame.begin(counters);
+                for (int c = 0; c < cycles_per_frame; c++)
+                    chip8.emulateCycle();
+                frame.end(counters, cycles_per_frame);
+
+                Stats stats("perfstat");
+                stats.add("rom", rom);
+                stats.add("frame", f);
+                frame.report(stats, counters);
+                emit(stats, stats_path);
+            }
+        }
+
+        Stats stats("perfstat");
+        stats.add("rom", rom);
+        stats.add("frames", frames);
+        stats.add("cycles_per_frame", cycles_per_frame);
+        stats.add("perf", counters.error().empty() ? "ok" : counters.error());
+        run.report(stats, counters);
+        dxyn.report(stats, counters);
+        emit(stats, stats_path);
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Startup benchmark: time from process start, and from main(), to the first executed
+// instruction of the emulator, plus the cost of a reset. Process start is measured by
+// spawning the real emulator binary (src/main.cpp) with --exit-after-first-instruction and
+// comparing CLOCK_MONOTONIC just before the spawn with the timestamp it prints after its
+// first emulateCycle(), so SDL, session and recorder setup are all part of it.
+//
+// Usage: startup [-b emulator] [-r runs] [-n resets] [-j stats.json] [rom]
+
+#include "chip-8.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+extern char **environ;
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Spawns the emulator and returns false if it could not be run
+static bool spawnEmulator(char *emulator, char *rom_path, uint64_t &process_ns, uint64_t &main_ns)
+{
+    int pipe_fd[2];
+    if (pipe(pipe_fd) < 0)
+        return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, pipe_fd[0]);
+
+    char exit_flag[] = "--exit-after-first-instruction";
+    char *child_argv[] = {emulator, exit_flag, rom_path, NULL};
+    pid_t pid;
+    uint64_t spawn_start = nowNs();
+    int error = posix_spawn(&pid, emulator, &actions, NULL, child_argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fd[1]);
+    if (error != 0)
+    {
+        close(pipe_fd[0]);
+        return false;
+    }
+
+    // The emulator logs its setup and shutdown to stdout too, read it all (so it never writes
+    // into a closed pipe) and keep the timestamp line
+    char line[512];
+    unsigned long long first_instruction, main_to_first;
+    bool ok = false;
+    FILE *fp = fdopen(pipe_fd[0], "r");
+    while (fp && fgets(line, sizeof(line), fp) != NULL)
+        if (!ok)
+            ok = sscanf(line, "first_instruction %llu %llu", &first_instruction, &main_to_first) == 2;
+    if (fp)
+        fclose(fp);
+    int status;
+    waitpid(pid, &status, 0);
+
+    if (!ok)
+        return false;
+    process_ns = first_instruction - spawn_start;
+    main_ns = main_to_first;
+    return true;
+}
+
+static double median(std::vector<uint64_t> values)
+{
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0 : (double)values[values.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 50;
+    int resets = 1000000;
+    const char *stats_path = NULL;
+    char *rom_path = (char *)"../roms/tetris.ch8";
+    char *emulator = (char *)"../src/chip8";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            emulator = argv[++i];
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            resets = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            stats_path = argv[++i];
+        else if (argv[i][0] != '-')
+            rom_path = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [-b emulator] [-r runs] [-n resets] [-j stats.json] [rom]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (resets < 1)
+        resets = 1;
+
+    // Process start to first instruction, through a real spawn
+    std::vector<uint64_t> process_ns, main_ns;
+    for (int i = 0; i < runs; i++)
+    {
+        uint64_t process, main_to_first;
+        if (!spawnEmulator(emulator, rom_path, process, main_to_first))
+        {
+            fprintf(stderr, "Could not run %s --exit-after-first-instruction\n", emulator);
+            break;
+        }
+        process_ns.push_back(process);
+        main_ns.push_back(main_to_first);
+    }
+
+    // Reset alone, and reset + load + first instruction, in a warm process
+    Chip8 chip8;
+    uint64_t start = nowNs();
+    for (int i = 0; i < resets; i++)
+        chip8.initialize();
+    double reset_ns = (double)(nowNs() - start) / resets;
+
+    int loads = std::min(resets, 10000);
+    start = nowNs();
+    for (int i = 0; i < loads; i++)
+    {
+        chip8.initialize();
+        chip8.loadGame(rom_path);
+        chip8.emulateCycle();
+    }
+    double warm_start_ns = (double)(nowNs() - start) / loads;
+
+    Stats stats("startup");
+    stats.add("rom", rom_path);
+    stats.add("emulator", emulator);
+    stats.add("runs", (int)process_ns.size());
+    stats.add("process_to_first_instruction_us_median", median(process_ns) / 1000);
+    stats.add("process_to_first_instruction_us_min", process_ns.empty() ? 0.0 : *std::min_element(process_ns.begin(), process_ns.end()) / 1000.0);
+    stats.add("main_to_first_instruction_us_median", median(main_ns) / 1000);
+    stats.add("reset_ns", reset_ns);
+    stats.add("warm_initialize_to_first_instruction_us", warm_start_ns / 1000);
+    stats.write(stdout);
+    if (stats_path)
+        stats.append(stats_path);
+    return 0;
+}